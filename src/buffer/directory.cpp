@@ -144,6 +144,16 @@ void Directory::Add(std::string directory)
    AddChild(directory);
 }
 
+void Directory::Add(std::vector<std::string> const & directories)
+{
+   paths_.reserve(paths_.size() + directories.size());
+
+   for (auto const & directory : directories)
+   {
+      Add(directory);
+   }
+}
+
 void Directory::AddChild(std::string directory)
 {
    std::string Parent = "";
@@ -180,6 +190,27 @@ void Directory::Add(Mpc::Song * song)
    songs_[Path].push_back(song);
 }
 
+void Directory::Add(std::vector<Mpc::Song *> const & songs)
+{
+   std::string                Path  = "";
+   std::vector<Mpc::Song *> * Songs = NULL;
+
+   // Songs in the same directory are listed together, so avoid looking up
+   // the directory for every song
+   for (auto song : songs)
+   {
+      std::string const SongPath = DirectoryFromURI(song->URI());
+
+      if ((Songs == NULL) || (SongPath != Path))
+      {
+         Path  = SongPath;
+         Songs = &songs_[Path];
+      }
+
+      Songs->push_back(song);
+   }
+}
+
 void Directory::AddPlaylist(Mpc::List playlist)
 {
    std::string Path = playlist.path_;
@@ -196,6 +227,53 @@ void Directory::AddPlaylist(Mpc::List playlist)
    playlists_[Path].push_back(playlist.path_);
 }
 
+void Directory::RemovePath(std::string const & path)
+{
+   std::string const Prefix = (path != "") ? path + "/" : "";
+
+   auto const Under = [&path, &Prefix] (std::string const & uri)
+   {
+      return ((uri == path) || (uri.compare(0, Prefix.size(), Prefix) == 0));
+   };
+
+   paths_.erase(std::remove_if(paths_.begin(), paths_.end(), Under), paths_.end());
+
+   for (auto it = children_.begin(); (it != children_.end()); )
+   {
+      if (Under(it->first) == true)
+      {
+         children_.erase(it++);
+      }
+      else
+      {
+         it->second.erase(std::remove_if(it->second.begin(), it->second.end(), Under), it->second.end());
+         ++it;
+      }
+   }
+
+   for (auto it = songs_.begin(); (it != songs_.end()); )
+   {
+      if ((path != "") && (Under(it->first) == true))
+      {
+         songs_.erase(it++);
+      }
+      else
+      {
+         // The path may also refer to a single song or everything
+         it->second.erase(std::remove_if(it->second.begin(), it->second.end(),
+                          [&Under] (Mpc::Song * song) { return Under(song->URI()); }), it->second.end());
+         ++it;
+      }
+   }
+
+   for (auto it = playlists_.begin(); (it != playlists_.end()); ++it)
+   {
+      it->second.erase(std::remove_if(it->second.begin(), it->second.end(), Under), it->second.end());
+   }
+
+   // Entries in the current view may point to songs that are about to be deleted
+   Clear();
+}
 
 void Directory::AddEntry(std::string fullPath)
 {
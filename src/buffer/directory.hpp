@@ -99,6 +99,7 @@ namespace Mpc
    class Directory : public Main::Buffer<DirectoryEntry *>
    {
       friend class Mpc::Song;
+      friend class Mpc::Library;
 
    public:
       using Main::Buffer<DirectoryEntry *>::Add;
@@ -121,9 +122,14 @@ namespace Mpc
 
       void Clear(bool fullClear = false);
       void Add(std::string directory);
+      void Add(std::vector<std::string> const & directories);
       void AddChild(std::string directory);
       void Add(Mpc::Song * song);
+      void Add(std::vector<Mpc::Song *> const & songs);
       void AddPlaylist(Mpc::List playlist);
+
+      //! Forget everything at or below the path, used before the path is updated
+      void RemovePath(std::string const & path);
       void AddToPlaylist(Mpc::Song::SongCollection Collection, Mpc::Client & client, Mpc::ClientState & clientState, uint32_t position);
       void RemoveFromPlaylist(Mpc::Song::SongCollection Collection, Mpc::Client & client, Mpc::ClientState & clientState, uint32_t position);
 
@@ -120,6 +120,26 @@ void Library::RecreateLibraryFromURIs()
 }
 
 void Library::Add(Mpc::Song * song)
+{
+   // Songs without tags are filed under the unknown artist until they are fetched
+   AddEntry(song);
+
+   uriMap_[song->URI()] = song;
+}
+
+void Library::Add(std::vector<Mpc::Song *> const & songs)
+{
+   for (auto song : songs)
+   {
+      AddEntry(song);
+
+      // The database is listed in order, so the songs normally belong at the end of the map
+      auto const it = uriMap_.insert(uriMap_.end(), std::make_pair(song->URI(), song));
+      it->second = song;
+   }
+}
+
+void Library::AddEntry(Mpc::Song * song)
 {
    std::string artist = song->Artist();
    std::string const album  = song->Album();
@@ -215,14 +235,311 @@ void Library::Add(Mpc::Song * song)
    entry->parent_   = lastAlbumEntry_;
    song->SetEntry(entry);
 
-   uriMap_[song->URI()] = song;
-
    if (lastAlbumEntry_ != NULL)
    {
       lastAlbumEntry_->children_.push_back(entry);
    }
 }
 
+std::vector<Mpc::Song *> Library::Update(std::string const & path, std::vector<Mpc::Song *> const & songs)
+{
+   std::vector<Mpc::Song *>           Result;
+   std::set<LibraryEntry *>           Affected;
+   std::map<std::string, Mpc::Song *> Fresh;
+
+   lastAlbumEntry_  = NULL;
+   lastArtistEntry_ = NULL;
+
+   for (auto song : songs)
+   {
+      Fresh[song->URI()] = song;
+   }
+
+   // Remove any song that was under the path but is no longer in the database
+   std::string const Prefix = (path != "") ? path + "/" : "";
+   std::vector<Mpc::Song *> Removed;
+
+   if ((uriMap_.find(path) != uriMap_.end()) && (Fresh.find(path) == Fresh.end()))
+   {
+      Removed.push_back(uriMap_[path]);
+   }
+
+   for (auto it = uriMap_.lower_bound(Prefix);
+        ((it != uriMap_.end()) && (it->first.compare(0, Prefix.size(), Prefix) == 0)); ++it)
+   {
+      if (Fresh.find(it->first) == Fresh.end())
+      {
+         Removed.push_back(it->second);
+      }
+   }
+
+   for (auto song : Removed)
+   {
+      RemoveSong(song, Affected);
+      uriMap_.erase(song->URI());
+
+      int32_t const BrowseIndex = Main::Browse().Index(song);
+
+      if (BrowseIndex >= 0)
+      {
+         Main::Browse().Remove(BrowseIndex, 1);
+      }
+
+      // Songs still in the playlist are deleted by it once they are removed
+      if (song->Reference() == 0)
+      {
+         delete song;
+      }
+   }
+
+   uint32_t const OldSize = Size();
+
+   for (auto song : songs)
+   {
+      Mpc::Song * const Existing = Song(song->URI());
+
+      if (Existing == NULL)
+      {
+         Add(song);
+         Result.push_back(song);
+      }
+      else
+      {
+         bool const Regroup = ((Existing->Entry()       == NULL) ||
+                               (Existing->Artist()      != song->Artist()) ||
+                               (Existing->AlbumArtist() != song->AlbumArtist()) ||
+                               (Existing->Album()       != song->Album()));
+
+         if (Regroup == true)
+         {
+            RemoveSong(Existing, Affected);
+         }
+
+         // Modify the existing song so that anything referring to it stays valid
+         Existing->CopyTags(*song);
+         delete song;
+
+         if (Regroup == true)
+         {
+            Add(Existing);
+
+            if (Existing->Reference() > 0)
+            {
+               Existing->Entry()->AddedToPlaylist();
+            }
+         }
+         else if (Existing->Entry() != NULL)
+         {
+            Existing->Entry()->date_ = Existing->Date();
+         }
+
+         Result.push_back(Existing);
+      }
+
+      LibraryEntry * const Entry = Result.back()->Entry();
+
+      if ((Entry != NULL) && (Entry->Parent() != NULL) && (Entry->Parent()->Parent() != NULL))
+      {
+         Affected.insert(Entry->Parent()->Parent());
+      }
+   }
+
+   SortAdded(OldSize, Affected);
+   return Result;
+}
+
+void Library::AddTags(std::vector<Mpc::Song *> const & songs)
+{
+   std::set<LibraryEntry *> Affected;
+
+   lastAlbumEntry_  = NULL;
+   lastArtistEntry_ = NULL;
+
+   uint32_t const OldSize = Size();
+
+   for (auto song : songs)
+   {
+      Mpc::Song * const Existing = Song(song->URI());
+
+      if ((Existing != NULL) && (Existing->Tags() != Mpc::Song::TagsLoaded))
+      {
+         // The placeholder moves from the unknown artist to where its tags say
+         bool const Filed = (Existing->Entry() != NULL);
+
+         if (Filed == true)
+         {
+            RemoveSong(Existing, Affected);
+         }
+
+         // Modify the placeholder so that anything referring to it stays valid
+         Existing->CopyTags(*song);
+         Existing->SetTagState(Mpc::Song::TagsLoaded);
+         AddEntry(Existing);
+
+         if (Existing->Reference() > 0)
+         {
+            Existing->Entry()->AddedToPlaylist();
+
+            if (Filed == false)
+            {
+               Main::Directory().AddedToPlaylist(Existing->URI());
+            }
+         }
+
+         LibraryEntry * const Entry = Existing->Entry();
+
+         if ((Entry->Parent() != NULL) && (Entry->Parent()->Parent() != NULL))
+         {
+            Affected.insert(Entry->Parent()->Parent());
+         }
+      }
+
+      delete song;
+   }
+
+   SortAdded(OldSize, Affected);
+}
+
+void Library::SortAdded(uint32_t oldSize, std::set<LibraryEntry *> const & affected)
+{
+   // New artists are added to the end, move them to where they belong
+   std::vector<LibraryEntry *> NewArtists;
+
+   while (Size() > oldSize)
+   {
+      NewArtists.push_back(Get(Size() - 1));
+      Remove(Size() - 1, 1);
+   }
+
+   for (auto artist : NewArtists)
+   {
+      InsertSorted(artist);
+   }
+
+   for (auto artist : affected)
+   {
+      Refresh(artist);
+   }
+}
+
+void Library::RemoveSong(Mpc::Song * const song, std::set<LibraryEntry *> & affected)
+{
+   LibraryEntry * const entry = song->Entry();
+
+   if (entry == NULL)
+   {
+      return;
+   }
+
+   if (song->Reference() > 0)
+   {
+      entry->RemovedFromPlaylist();
+   }
+
+   LibraryEntry * const album  = entry->parent_;
+   LibraryEntry * const artist = (album != NULL) ? album->parent_ : NULL;
+
+   RemoveFromBuffer(entry);
+   entry->song_ = NULL;
+   song->SetEntry(NULL);
+   delete entry;
+
+   if (album != NULL)
+   {
+      album->children_.erase(std::remove(album->children_.begin(), album->children_.end(), entry), album->children_.end());
+
+      if (album->children_.empty() == true)
+      {
+         RemoveFromBuffer(album);
+
+         if (artist != NULL)
+         {
+            artist->children_.erase(std::remove(artist->children_.begin(), artist->children_.end(), album), artist->children_.end());
+         }
+
+         delete album;
+      }
+   }
+
+   if (artist != NULL)
+   {
+      if (artist->children_.empty() == true)
+      {
+         affected.erase(artist);
+         RemoveFromBuffer(artist);
+         delete artist;
+      }
+      else
+      {
+         affected.insert(artist);
+      }
+   }
+}
+
+void Library::RemoveFromBuffer(LibraryEntry * const entry)
+{
+   int32_t const Pos = Index(entry);
+
+   if (Pos >= 0)
+   {
+      Remove(Pos, 1);
+   }
+
+   CheckIfVariousRemoved(entry);
+}
+
+void Library::Refresh(LibraryEntry * const artist)
+{
+   Sort(artist);
+
+   int32_t const Line = Index(artist);
+
+   // Expand the entries again so that the buffer reflects the new contents
+   // whilst keeping the same entries expanded as before
+   if ((Line >= 0) && (artist->expanded_ == true))
+   {
+      std::vector<LibraryEntry *> Expanded;
+
+      for (auto child : artist->children_)
+      {
+         if (child->expanded_ == true)
+         {
+            Expanded.push_back(child);
+         }
+      }
+
+      Collapse(Line);
+      Expand(Line);
+
+      for (auto album : Expanded)
+      {
+         int32_t const AlbumLine = Index(album);
+
+         if (AlbumLine >= 0)
+         {
+            Expand(AlbumLine);
+         }
+      }
+   }
+}
+
+void Library::InsertSorted(LibraryEntry * const artist)
+{
+   Mpc::LibraryEntry::LibraryComparator comparator;
+
+   uint32_t i = 0;
+
+   for (i = 0; (i < Size()); ++i)
+   {
+      if ((Get(i)->parent_ == NULL) && (comparator(artist, Get(i)) == true))
+      {
+         break;
+      }
+   }
+
+   Add(artist, i);
+}
+
 void Library::CreateVariousArtist()
 {
    if (variousArtist_ == NULL)
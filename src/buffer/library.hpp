@@ -26,6 +26,7 @@
 #include "settings.hpp"
 #include "song.hpp"
 
+#include <set>
 #include <vector>
 
 namespace Ui   { class LibraryWindow; }
@@ -232,6 +233,17 @@ namespace Mpc
       void Sort();
       void Sort(LibraryEntry * entry);
       void Add(Mpc::Song * song);
+      void Add(std::vector<Mpc::Song *> const & songs);
+
+      //! Apply the result of listing a single path of the database again,
+      //! the songs returned are the library's copies of the given songs
+      std::vector<Mpc::Song *> Update(std::string const & path, std::vector<Mpc::Song *> const & songs);
+
+      //! Copy the tags fetched for songs that were listed without them
+      //! and file the songs under their artist and album, the given songs
+      //! are deleted
+      void AddTags(std::vector<Mpc::Song *> const & songs);
+
       void AddToPlaylist(Mpc::Song::SongCollection Collection, Mpc::Client & client, Mpc::ClientState & clientState, uint32_t position);
       void RemoveFromPlaylist(Mpc::Song::SongCollection Collection, Mpc::Client & client, Mpc::ClientState & clientState, uint32_t position);
 
@@ -253,6 +265,7 @@ namespace Mpc
 
    private:
       void RecreateLibraryFromURIs();
+      void AddEntry(Mpc::Song * song);
 
       void AddToPlaylist(Mpc::Client & client, Mpc::ClientState & clientState, Mpc::LibraryEntry const * const entry, int32_t position = -1);
       void RemoveFromPlaylist(Mpc::Client & client, Mpc::LibraryEntry const * const entry);
@@ -260,6 +273,12 @@ namespace Mpc
       void CheckIfVariousRemoved(LibraryEntry * const entry);
       void RemoveAndUnexpand(LibraryEntry * const entry);
 
+      void RemoveSong(Mpc::Song * const song, std::set<LibraryEntry *> & affected);
+      void RemoveFromBuffer(LibraryEntry * const entry);
+      void Refresh(LibraryEntry * const artist);
+      void InsertSorted(LibraryEntry * const artist);
+      void SortAdded(uint32_t oldSize, std::set<LibraryEntry *> const & affected);
+
    private:
       Main::Settings & settings_;
       std::map<std::string, Mpc::Song *> uriMap_;
@@ -0,0 +1,81 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   servers.hpp - mpd instances that are being monitored
+   */
+
+#ifndef __MPC__SERVERS
+#define __MPC__SERVERS
+
+// Includes
+#include "buffer.hpp"
+#include "events.hpp"
+#include "server.hpp"
+#include "vimpc.hpp"
+
+// Servers
+namespace Mpc
+{
+   class Servers : public Main::Buffer<Mpc::Server *>
+   {
+   public:
+      Servers() :
+         activeHostname_(""),
+         activePort_    (0)
+      {
+         Main::Vimpc::EventHandler(Event::ChangeHost, [this] (EventData const & Data)
+            { activeHostname_ = Data.hostname; activePort_ = Data.port; });
+      }
+      ~Servers()
+      {
+         for (uint32_t i = 0; i < Size(); ++i)
+         {
+            delete Get(i);
+         }
+
+         Clear();
+      }
+
+      Mpc::Server * Find(std::string const & hostname, uint16_t port) const
+      {
+         for (uint32_t i = 0; i < Size(); ++i)
+         {
+            if ((Get(i)->Hostname() == hostname) && (Get(i)->Port() == port))
+            {
+               return Get(i);
+            }
+         }
+
+         return NULL;
+      }
+
+      // The server the client is currently connected to
+      bool Active(uint32_t position) const
+      {
+         return ((Get(position)->Hostname() == activeHostname_) && (Get(position)->Port() == activePort_));
+      }
+
+      std::string String(uint32_t position) const      { return Get(position)->Hostname(); }
+      std::string PrintString(uint32_t position) const { return Get(position)->PrintString(Active(position)); }
+
+   private:
+      std::string activeHostname_;
+      uint16_t    activePort_;
+   };
+}
+#endif
+/* vim: set sw=3 ts=3: */
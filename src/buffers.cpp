@@ -27,6 +27,7 @@
 #include "buffer/list.hpp"
 #include "buffer/outputs.hpp"
 #include "buffer/playlist.hpp"
+#include "buffer/servers.hpp"
 #include "window/console.hpp"
 
 static Mpc::Playlist *  p_buffer    = NULL;
@@ -39,11 +40,52 @@ static Mpc::Lists *     f_buffer    = NULL;
 static Mpc::Lists *     m_buffer    = NULL;
 static Mpc::Lists *     i_buffer    = NULL;
 static Mpc::Outputs *   o_buffer    = NULL;
+static Mpc::Servers *   s_buffer    = NULL;
 static Ui::Console *    c_buffer    = NULL;
 static Ui::Console *    d_buffer    = NULL;
 static Ui::Console *    x_buffer    = NULL;
 static Main::Lyrics *   y_buffer    = NULL;
 
+// Replace the playlist files found below an updated path of the database
+static void UpdateListFiles(Mpc::Lists & lists, EventData const & Data)
+{
+   std::string const Prefix = (Data.uri != "") ? Data.uri + "/" : "";
+
+   for (int32_t i = static_cast<int32_t>(lists.Size()) - 1; i >= 0; --i)
+   {
+      Mpc::List const & list = lists.Get(i);
+
+      if ((list.file_ == true) &&
+          ((list.path_ == Data.uri) || (list.path_.compare(0, Prefix.size(), Prefix) == 0)))
+      {
+         lists.Remove(i, 1);
+      }
+   }
+
+   for (auto path : Data.Payload().listfiles)
+   {
+      lists.Add(Mpc::List(path, Mpc::Directory::FileFromURI(path)));
+   }
+}
+
+static void UpdateStoredLists(Mpc::Lists & lists, EventData const & Data)
+{
+   for (int32_t i = static_cast<int32_t>(lists.Size()) - 1; i >= 0; --i)
+   {
+      if (lists.Get(i).file_ == false)
+      {
+         lists.Remove(i, 1);
+      }
+   }
+
+   for (auto name : Data.Payload().uris)
+   {
+      lists.Add(Mpc::List(name));
+   }
+
+   lists.Sort();
+}
+
 void Main::Delete()
 {
    delete l_buffer;
@@ -56,6 +98,7 @@ void Main::Delete()
    delete m_buffer;
    delete i_buffer;
    delete o_buffer;
+   delete s_buffer;
    delete c_buffer;
    delete d_buffer;
    delete x_buffer;
@@ -93,7 +136,7 @@ Mpc::Playlist & Main::Playlist()
 
       Main::Vimpc::EventHandler(Event::PlaylistQueueReplace, [] (EventData const & Data)
          {
-            for (auto pair : Data.posuri)
+            for (auto pair : Data.Payload().posuri)
             {
                Mpc::Song * song = (pair.second.first != NULL) ? pair.second.first : Main::Library().Song(pair.second.second);
 
@@ -149,8 +192,40 @@ Mpc::Library & Main::Library()
       l_buffer = new Mpc::Library();
       Main::Vimpc::EventHandler(Event::ClearDatabase, [] (EventData const & Data)
          { Main::Library().Clear(); });
-      Main::Vimpc::EventHandler(Event::DatabaseSong,  [] (EventData const & Data)
-         { Main::Library().Add(Data.song); });
+      Main::Vimpc::EventHandler(Event::DatabaseSongs, [] (EventData const & Data)
+         { Main::Library().Add(Data.Payload().songs); });
+      Main::Vimpc::EventHandler(Event::SongTags, [] (EventData const & Data)
+         {
+            Main::Library().AddTags(Data.Payload().songs);
+
+            // Songs that never got a reply are asked for again when next shown
+            for (auto uri : Data.Payload().uris)
+            {
+               Mpc::Song * const song = Main::Library().Song(uri);
+
+               if ((song != NULL) && (song->Tags() == Mpc::Song::TagsRequested))
+               {
+                  song->SetTagState(Mpc::Song::TagsMissing);
+               }
+            }
+         });
+      Main::Vimpc::EventHandler(Event::DatabasePathUpdate, [] (EventData const & Data)
+         {
+            // The directory has to drop its songs before the library deletes any
+            Main::Directory().RemovePath(Data.uri);
+
+            std::vector<Mpc::Song *> const Songs = Main::Library().Update(Data.uri, Data.Payload().songs);
+
+            Main::Directory().Add(Data.Payload().uris);
+            Main::Directory().Add(Songs);
+
+            for (auto path : Data.Payload().listfiles)
+            {
+               Main::Directory().AddPlaylist(Mpc::List(path, Mpc::Directory::FileFromURI(path)));
+            }
+
+            Main::Directory().ChangeDirectory(Main::Directory().CurrentDirectory());
+         });
    }
    return *l_buffer;
 }
@@ -162,10 +237,10 @@ Mpc::Directory & Main::Directory()
       dir_buffer = new Mpc::Directory();
       Main::Vimpc::EventHandler(Event::ClearDatabase, [] (EventData const & Data)
          { Main::Directory().Clear(true); });
-      Main::Vimpc::EventHandler(Event::DatabaseSong,  [] (EventData const & Data)
-         { Main::Directory().Add(Data.song); });
-      Main::Vimpc::EventHandler(Event::DatabasePath, [] (EventData const & Data)
-         { Main::Directory().Add(Data.uri); });
+      Main::Vimpc::EventHandler(Event::DatabaseSongs, [] (EventData const & Data)
+         { Main::Directory().Add(Data.Payload().songs); });
+      Main::Vimpc::EventHandler(Event::DatabasePaths, [] (EventData const & Data)
+         { Main::Directory().Add(Data.Payload().uris); });
       Main::Vimpc::EventHandler(Event::DatabaseListFile, [] (EventData const & Data)
          { Mpc::List const list(Data.uri, Data.name); Main::Directory().AddPlaylist(list); });
    }
@@ -181,6 +256,8 @@ Mpc::Lists & Main::FileLists()
          { Main::FileLists().Clear(); });
       Main::Vimpc::EventHandler(Event::DatabaseListFile, [] (EventData const & Data)
          { Mpc::List const list(Data.uri, Data.name); Main::FileLists().Add(list); });
+      Main::Vimpc::EventHandler(Event::DatabasePathUpdate, [] (EventData const & Data)
+         { UpdateListFiles(Main::FileLists(), Data); });
    }
    return *f_buffer;
 }
@@ -194,6 +271,8 @@ Mpc::Lists & Main::MpdLists()
          { Main::MpdLists().Clear(); });
       Main::Vimpc::EventHandler(Event::DatabaseList, [] (EventData const & Data)
          { Mpc::List const list(Data.name); Main::MpdLists().Add(list); });
+      Main::Vimpc::EventHandler(Event::StoredPlaylists, [] (EventData const & Data)
+         { UpdateStoredLists(Main::MpdLists(), Data); });
       Main::Vimpc::EventHandler(Event::NewPlaylist, [] (EventData const & Data)
          {
             if (Main::MpdLists().Index(Mpc::List(Data.name)) == -1)
@@ -215,8 +294,12 @@ Mpc::Lists & Main::AllLists()
          { Main::AllLists().Clear(); });
       Main::Vimpc::EventHandler(Event::DatabaseListFile, [] (EventData const & Data)
          { Mpc::List const list(Data.uri, Data.name); Main::AllLists().Add(list); });
+      Main::Vimpc::EventHandler(Event::DatabasePathUpdate, [] (EventData const & Data)
+         { UpdateListFiles(Main::AllLists(), Data); });
       Main::Vimpc::EventHandler(Event::DatabaseList, [] (EventData const & Data)
          { Mpc::List const list(Data.name); Main::AllLists().Add(list); });
+      Main::Vimpc::EventHandler(Event::StoredPlaylists, [] (EventData const & Data)
+         { UpdateStoredLists(Main::AllLists(), Data); });
       Main::Vimpc::EventHandler(Event::NewPlaylist, [] (EventData const & Data)
          {
             if (Main::AllLists().Index(Mpc::List(Data.name)) == -1)
@@ -240,6 +323,15 @@ Mpc::Outputs & Main::Outputs()
    return *o_buffer;
 }
 
+Mpc::Servers & Main::Servers()
+{
+   if (s_buffer == NULL)
+   {
+      s_buffer = new Mpc::Servers();
+   }
+   return *s_buffer;
+}
+
 Ui::Console & Main::Console()
 {
    if (c_buffer == NULL)
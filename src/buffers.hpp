@@ -33,6 +33,7 @@ namespace Mpc
    class Directory;
    class Lists;
    class Outputs;
+   class Servers;
 }
 
 namespace Ui
@@ -56,6 +57,7 @@ namespace Main
    Mpc::Lists     & MpdLists();
    Mpc::Lists     & AllLists();
    Mpc::Outputs   & Outputs();
+   Mpc::Servers   & Servers();
    Ui::Console    & Console();
    Ui::Console    & DebugConsole();
    Ui::Console    & TestConsole();
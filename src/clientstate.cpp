@@ -62,6 +62,8 @@ ClientState::ClientState(Main::Vimpc * vimpc, Main::Settings & settings, Ui::Scr
    currentSong_          (NULL),
    currentSongId_        (-1),
    totalNumberOfSongs_   (0),
+   loading_              (false),
+   loadedSongs_          (0),
    currentState_         ("Disconnected"),
    lastTitleStr_         ("")
 {
@@ -86,6 +88,7 @@ ClientState::ClientState(Main::Vimpc * vimpc, Main::Settings & settings, Ui::Scr
       this->currentSongId_      = -1;
       this->currentSongURI_     = "";
       this->totalNumberOfSongs_ = 0;
+      this->loading_            = false;
 
       if (currentSong_ != NULL)
       {
@@ -100,9 +103,27 @@ ClientState::ClientState(Main::Vimpc * vimpc, Main::Settings & settings, Ui::Scr
 
    Main::Vimpc::EventHandler(Event::ClearDatabase, [this] (EventData const & Data)
    {
+      this->loading_     = true;
+      this->loadedSongs_ = 0;
       DisplaySongInformation();
    });
 
+   Main::Vimpc::EventHandler(Event::DatabaseSongs, [this] (EventData const & Data)
+   {
+      this->loadedSongs_ += Data.Payload().songs.size();
+
+      EventData EData;
+      Main::Vimpc::CreateEvent(Event::StatusUpdate, EData);
+   });
+
+   Main::Vimpc::EventHandler(Event::AllMetaDataReady, [this] (EventData const & Data)
+   {
+      this->loading_ = false;
+
+      EventData EData;
+      Main::Vimpc::CreateEvent(Event::StatusUpdate, EData);
+   });
+
    Main::Vimpc::EventHandler(Event::DisplaySongInfo, [this] (EventData const & Data)
    {
       DisplaySongInformation();
@@ -330,6 +351,16 @@ bool ClientState::IsUpdating() const
    return updating_;
 }
 
+bool ClientState::IsLoading() const
+{
+   return loading_;
+}
+
+uint32_t ClientState::LoadedSongs() const
+{
+   return loadedSongs_;
+}
+
 std::string ClientState::CurrentState() const
 {
    return currentState_;
@@ -73,6 +73,10 @@ namespace Mpc
       bool Mute() const;
       bool IsUpdating() const;
 
+      //! Whether the database is still being downloaded and how far it has got
+      bool IsLoading() const;
+      uint32_t LoadedSongs() const;
+
    public:
       // Mpd Status
       std::string CurrentState() const ;
@@ -119,6 +123,8 @@ namespace Mpc
       mpd_song *              currentSong_;
       int32_t                 currentSongId_;
       uint32_t                totalNumberOfSongs_;
+      bool                    loading_;
+      uint32_t                loadedSongs_;
       std::string             currentSongURI_;
       std::string             currentState_;
       std::string             lastTitleStr_;
@@ -0,0 +1,221 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   commandqueue.cpp - commands waiting to be run by the client thread
+   */
+
+#include "commandqueue.hpp"
+
+using namespace Mpc;
+
+Completion::Completion() :
+   done_(false)
+{
+}
+
+Completion::~Completion()
+{
+}
+
+void Completion::Signal()
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   done_ = true;
+   condition_.notify_all();
+}
+
+bool Completion::Done() const
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   return done_;
+}
+
+void Completion::Wait()
+{
+   UniqueLock<Mutex> Lock(mutex_);
+
+   while (done_ == false)
+   {
+      condition_.wait(Lock);
+   }
+}
+
+bool Completion::Wait(int timeoutMs)
+{
+   UniqueLock<Mutex> Lock(mutex_);
+
+   if (done_ == false)
+   {
+      ConditionWait(condition_, Lock, timeoutMs);
+   }
+
+   return done_;
+}
+
+
+CommandQueue::CommandQueue() :
+   head_       (0),
+   tail_       (0),
+   pushed_     (0),
+   popped_     (0),
+   overflowing_(false)
+{
+   for (uint32_t i = 0; i < Capacity; ++i)
+   {
+      ring_[i].sequence.store(i, std::memory_order_relaxed);
+   }
+}
+
+CommandQueue::~CommandQueue()
+{
+}
+
+CompletionHandle CommandQueue::Push(Command const & command, bool batchable, uint64_t after)
+{
+   CompletionHandle completion(new Completion());
+
+   if ((overflowing_.load(std::memory_order_acquire) == true) ||
+       (TryPush(command, completion, batchable, after) == false))
+   {
+      Overflow const Entry = { command, completion, batchable, after };
+
+      UniqueLock<Mutex> Lock(overflowMutex_);
+      overflow_.push_back(Entry);
+      overflowing_.store(true, std::memory_order_release);
+   }
+
+   pushed_.fetch_add(1, std::memory_order_acq_rel);
+   return completion;
+}
+
+bool CommandQueue::TryPush(Command const & command, CompletionHandle const & completion, bool batchable, uint64_t after)
+{
+   uint64_t position = tail_.load(std::memory_order_relaxed);
+   Entry *  entry    = NULL;
+
+   while (entry == NULL)
+   {
+      Entry &        next     = ring_[position % Capacity];
+      uint64_t const sequence = next.sequence.load(std::memory_order_acquire);
+
+      if (sequence == position)
+      {
+         if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed) == true)
+         {
+            entry = &next;
+         }
+      }
+      else if (sequence < position)
+      {
+         // The consumer has not yet freed this slot so the ring is full
+         return false;
+      }
+      else
+      {
+         position = tail_.load(std::memory_order_relaxed);
+      }
+   }
+
+   entry->command    = command;
+   entry->completion = completion;
+   entry->batchable  = batchable;
+   entry->after      = after;
+   entry->sequence.store(position + 1, std::memory_order_release);
+   return true;
+}
+
+bool CommandQueue::Pop(Command & command, CompletionHandle & completion)
+{
+   bool batchable = false;
+   return Pop(command, completion, batchable);
+}
+
+bool CommandQueue::Pop(Command & command, CompletionHandle & completion, bool & batchable)
+{
+   uint64_t after = 0;
+   return Pop(command, completion, batchable, after);
+}
+
+bool CommandQueue::Pop(Command & command, CompletionHandle & completion, bool & batchable, uint64_t & after)
+{
+   uint64_t const position = head_.load(std::memory_order_relaxed);
+   Entry &        entry    = ring_[position % Capacity];
+
+   if (entry.sequence.load(std::memory_order_acquire) == position + 1)
+   {
+      command    = entry.command;
+      completion = entry.completion;
+      batchable  = entry.batchable;
+      after      = entry.after;
+      entry.command    = Command();
+      entry.completion.reset();
+
+      entry.sequence.store(position + Capacity, std::memory_order_release);
+      head_.store(position + 1, std::memory_order_relaxed);
+      popped_.fetch_add(1, std::memory_order_acq_rel);
+      return true;
+   }
+
+   if (overflowing_.load(std::memory_order_acquire) == true)
+   {
+      UniqueLock<Mutex> Lock(overflowMutex_);
+
+      // Anything in the ring, even a slot that is claimed but not yet
+      // written, was pushed before the overflow so has to be run first.
+      // This is checked under the lock so that it sees every slot
+      // claimed before the overflow entries were added.
+      if ((tail_.load(std::memory_order_acquire) == position) &&
+          (overflow_.empty() == false))
+      {
+         command    = overflow_.front().command;
+         completion = overflow_.front().completion;
+         batchable  = overflow_.front().batchable;
+         after      = overflow_.front().after;
+         overflow_.pop_front();
+         popped_.fetch_add(1, std::memory_order_acq_rel);
+
+         if (overflow_.empty() == true)
+         {
+            overflowing_.store(false, std::memory_order_release);
+         }
+
+         return true;
+      }
+   }
+
+   return false;
+}
+
+bool CommandQueue::Empty() const
+{
+   uint64_t const position = head_.load(std::memory_order_relaxed);
+
+   return ((ring_[position % Capacity].sequence.load(std::memory_order_acquire) != position + 1) &&
+           (overflowing_.load(std::memory_order_acquire) == false));
+}
+
+uint64_t CommandQueue::Pushed() const
+{
+   return pushed_.load(std::memory_order_acquire);
+}
+
+uint64_t CommandQueue::Popped() const
+{
+   return popped_.load(std::memory_order_acquire);
+}
+
+/* vim: set sw=3 ts=3: */
@@ -0,0 +1,133 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   commandqueue.hpp - commands waiting to be run by the client thread
+   */
+
+#ifndef __MPC__COMMANDQUEUE
+#define __MPC__COMMANDQUEUE
+
+#include "compiler.hpp"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <stdint.h>
+
+namespace Mpc
+{
+   //! Signalled once the command it was returned for has been run
+   class Completion
+   {
+   public:
+      Completion();
+      ~Completion();
+
+   private:
+      Completion(Completion const & completion);
+      Completion & operator=(Completion const & completion);
+
+   public:
+      void Signal();
+      bool Done() const;
+
+      void Wait();
+
+      //! Returns false if the command had not run within the timeout
+      bool Wait(int timeoutMs);
+
+   private:
+      mutable Mutex     mutex_;
+      ConditionVariable condition_;
+      bool              done_;
+   };
+
+   typedef std::shared_ptr<Completion> CompletionHandle;
+
+   //! Bounded lock free ring that any thread may push to but only the
+   //! client thread pops from. If the ring fills up commands spill into
+   //! a locked list so that a push never blocks or fails.
+   class CommandQueue
+   {
+   public:
+      typedef FUNCTION<void()> Command;
+
+      CommandQueue();
+      ~CommandQueue();
+
+   private:
+      CommandQueue(CommandQueue const & queue);
+      CommandQueue & operator=(CommandQueue const & queue);
+
+   public:
+      //! Batchable commands only send a request and leave reading the
+      //! response until later, so they can be sent in a command list.
+      //! \p after is handed back by Pop for the consumer to order on.
+      CompletionHandle Push(Command const & command, bool batchable = false, uint64_t after = 0);
+
+      //! Only to be called from the consumer thread
+      bool Pop(Command & command, CompletionHandle & completion);
+      bool Pop(Command & command, CompletionHandle & completion, bool & batchable);
+      bool Pop(Command & command, CompletionHandle & completion, bool & batchable, uint64_t & after);
+      bool Empty() const;
+
+      //! Number of commands that have been pushed and popped so far
+      uint64_t Pushed() const;
+      uint64_t Popped() const;
+
+   private:
+      struct Entry
+      {
+         Entry() : sequence(0), batchable(false), after(0) { }
+
+         std::atomic<uint64_t> sequence;
+         Command               command;
+         CompletionHandle      completion;
+         bool                  batchable;
+         uint64_t              after;
+      };
+
+      struct Overflow
+      {
+         Command               command;
+         CompletionHandle      completion;
+         bool                  batchable;
+         uint64_t              after;
+      };
+
+      bool TryPush(Command const & command, CompletionHandle const & completion, bool batchable, uint64_t after);
+
+   private:
+      static uint32_t const Capacity = 1024;
+
+      Entry                 ring_[Capacity];
+      std::atomic<uint64_t> head_;
+      std::atomic<uint64_t> tail_;
+      std::atomic<uint64_t> pushed_;
+      std::atomic<uint64_t> popped_;
+
+      // Once anything has spilled over everything goes to the overflow
+      // until it has been drained, otherwise a thread's commands could
+      // be run out of order
+      std::atomic<bool>     overflowing_;
+      mutable Mutex         overflowMutex_;
+      std::list<Overflow>   overflow_;
+   };
+}
+
+#endif
+/* vim: set sw=3 ts=3: */
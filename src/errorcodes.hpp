@@ -50,6 +50,7 @@
    X(NameInUse,             "Name already in use") \
    X(NotSet,                "Required setting not set") \
    X(FileNotFound,          "File not found") \
+   X(FileNotWritten,        "Unable to write file") \
    X(NoRangeAllowed,        "No range allowed for command") \
    X(ErrorClear,            "Clear all other errors") \
    X(WindowDisabled,        "Window not supported and is disabled") \
@@ -22,7 +22,9 @@
 #ifndef __EVENTS
 #define __EVENTS
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "song.hpp"
 
@@ -43,10 +45,14 @@
    X(ClearDatabase, "ClearDatabase") \
    X(DatabaseList, "DatabaseList") \
    X(DatabaseListFile, "DatabaseListFile") \
-   X(DatabasePath, "DatabasePath") \
-   X(DatabaseSong, "DatabaseSong") \
+   X(DatabasePaths, "DatabasePaths") \
+   X(DatabaseSongs, "DatabaseSongs") \
+   X(DatabasePathUpdate, "DatabasePathUpdate") \
+   X(SongTags, "SongTags") \
+   X(TagsApplied, "TagsApplied") \
    X(AllMetaDataReady, "AllMetaDataReady") \
    X(NewPlaylist, "NewPlaylist") \
+   X(StoredPlaylists, "StoredPlaylists") \
    X(PlaylistAdd, "PlaylistAdd") \
    X(PlaylistQueueReplace, "PlaylistQueueReplace") \
    X(Output, "Output") \
@@ -101,6 +107,15 @@ public:
    static std::string Default[];
 };
 
+//! The lists only a few events carry, kept apart so the rest stay small
+struct EventPayload
+{
+   std::vector<std::string> uris;
+   std::vector<std::string> listfiles;
+   std::vector<Mpc::Song *> songs;
+   std::vector<std::pair<int32_t, std::pair<Mpc::Song *, std::string> > > posuri;
+};
+
 struct EventData
 {
    EventData() :
@@ -110,6 +125,46 @@ struct EventData
       currentSong(NULL)
          { }
 
+   EventData(EventData const & data) :
+      input(data.input), count(data.count), value(data.value),
+      pos1(data.pos1), pos2(data.pos2), id(data.id), port(data.port),
+      state(data.state), user(data.user),
+      uri(data.uri), name(data.name), hostname(data.hostname),
+      clientstate(data.clientstate),
+      song(data.song), output(data.output), currentSong(data.currentSong),
+      payload_((data.payload_ != NULL) ? new EventPayload(*data.payload_) : NULL)
+         { }
+
+   EventData(EventData && data) = default;
+   EventData & operator=(EventData && data) = default;
+
+   EventData & operator=(EventData const & data)
+   {
+      if (this != &data)
+      {
+         *this = EventData(data);
+      }
+
+      return *this;
+   }
+
+   //! The payload is only allocated by events that fill it in
+   EventPayload & Payload()
+   {
+      if (payload_ == NULL)
+      {
+         payload_.reset(new EventPayload());
+      }
+
+      return *payload_;
+   }
+
+   EventPayload const & Payload() const
+   {
+      static EventPayload const Empty;
+      return (payload_ != NULL) ? *payload_ : Empty;
+   }
+
    int32_t  input;
    int32_t  count;
    int32_t  value;
@@ -127,8 +182,8 @@ struct EventData
    Mpc::Output * output;
    mpd_song *  currentSong;
 
-   std::vector<std::string> uris;
-   std::vector<std::pair<int32_t, std::pair<Mpc::Song *, std::string> > > posuri;
+private:
+   std::unique_ptr<EventPayload> payload_;
 };
 
 #endif
@@ -0,0 +1,450 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   filter.cpp - compound queries over song tags
+   */
+
+#include "filter.hpp"
+
+#include <algorithm>
+#include <ctype.h>
+
+#include "regex.hpp"
+#include "song.hpp"
+
+using namespace Mpc;
+
+// Tags that can be compared, with the name mpd gives them in filter expressions
+static struct
+{
+   char const * name;
+   char const * mpd;
+   Mpc::Song::SongInformationFunction function;
+} const Tags[] =
+{
+   { "any",         "any",         NULL },
+   { "artist",      "Artist",      &Mpc::Song::Artist },
+   { "albumartist", "AlbumArtist", &Mpc::Song::AlbumArtist },
+   { "album",       "Album",       &Mpc::Song::Album },
+   { "title",       "Title",       &Mpc::Song::Title },
+   { "track",       "Track",       &Mpc::Song::Track },
+   { "genre",       "Genre",       &Mpc::Song::Genre },
+   { "date",        "Date",        &Mpc::Song::Date },
+   { "disc",        "Disc",        &Mpc::Song::Disc },
+   { "file",        "file",        &Mpc::Song::URI },
+};
+
+static uint32_t const TagCount = sizeof(Tags) / sizeof(Tags[0]);
+
+// mpd's any only compares the tags, not the path of the song
+static uint32_t const FileTag  = TagCount - 1;
+
+static std::string Lower(std::string value)
+{
+   std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+   return value;
+}
+
+// Quoted tokens keep their opening quote so they are never taken as keywords
+static bool IsQuoted(std::string const & token)
+{
+   return ((token.empty() == false) && ((token[0] == '"') || (token[0] == '\'')));
+}
+
+static std::string Unquote(std::string const & token)
+{
+   return (IsQuoted(token) == true) ? token.substr(1) : token;
+}
+
+static std::string RegexEscape(std::string const & value)
+{
+   std::string escaped;
+
+   for (auto c : value)
+   {
+      if (std::string("\\^$.|?*+()[]{}").find(c) != std::string::npos)
+      {
+         escaped += '\\';
+      }
+
+      escaped += c;
+   }
+
+   return escaped;
+}
+
+static bool IsKeyword(std::string const & token, char const * word, char const * symbol)
+{
+   return ((IsQuoted(token) == false) && ((Lower(token) == word) || (token == symbol)));
+}
+
+
+struct Filter::Node
+{
+   typedef enum
+   {
+      Compare,
+      And,
+      Or,
+      Not
+   } Type;
+
+   typedef enum
+   {
+      Equal,
+      NotEqual,
+      Contains,
+      Match,
+      NotMatch
+   } Operator;
+
+   Node(Type type, Node * left = NULL, Node * right = NULL) :
+      type_  (type),
+      op_    (Equal),
+      tag_   (0),
+      value_ (""),
+      regex_ (NULL),
+      left_  (left),
+      right_ (right)
+   {
+   }
+
+   ~Node()
+   {
+      delete regex_;
+      delete left_;
+      delete right_;
+   }
+
+   Type        type_;
+   Operator    op_;
+   uint32_t    tag_;
+   std::string value_;
+   Regex::RE * regex_;
+   Node *      left_;
+   Node *      right_;
+};
+
+
+Filter::Filter(std::string const & query) :
+   query_    (query),
+   position_ (0),
+   error_    (""),
+   root_     (NULL)
+{
+   if (Peek() == "")
+   {
+      error_ = "expected a query";
+   }
+   else
+   {
+      root_ = ParseOr();
+
+      if ((root_ != NULL) && (Peek() != ""))
+      {
+         error_ = "unexpected '" + Unquote(Peek()) + "'";
+         delete root_;
+         root_ = NULL;
+      }
+   }
+}
+
+Filter::~Filter()
+{
+   delete root_;
+}
+
+
+std::string Filter::Expression(bool contains) const
+{
+   return (root_ != NULL) ? Expression(root_, contains) : "";
+}
+
+bool Filter::Matches(Mpc::Song const & song) const
+{
+   return (root_ != NULL) ? Matches(root_, song) : false;
+}
+
+
+Filter::Node * Filter::ParseOr()
+{
+   Node * node = ParseAnd();
+
+   while ((node != NULL) && (IsKeyword(Peek(), "or", "||") == true))
+   {
+      Next();
+      Node * const right = ParseAnd();
+
+      if (right == NULL)
+      {
+         delete node;
+         return NULL;
+      }
+
+      node = new Node(Node::Or, node, right);
+   }
+
+   return node;
+}
+
+Filter::Node * Filter::ParseAnd()
+{
+   Node * node = ParseNot();
+
+   while ((node != NULL) && (IsKeyword(Peek(), "and", "&&") == true))
+   {
+      Next();
+      Node * const right = ParseNot();
+
+      if (right == NULL)
+      {
+         delete node;
+         return NULL;
+      }
+
+      node = new Node(Node::And, node, right);
+   }
+
+   return node;
+}
+
+Filter::Node * Filter::ParseNot()
+{
+   std::string const token = Peek();
+
+   if (IsKeyword(token, "not", "!") == true)
+   {
+      Next();
+      Node * const child = ParseNot();
+      return (child != NULL) ? new Node(Node::Not, child) : NULL;
+   }
+   else if (token == "(")
+   {
+      Next();
+      Node * node = ParseOr();
+
+      if ((node != NULL) && (Next() != ")"))
+      {
+         error_ = "expected ')'";
+         delete node;
+         node = NULL;
+      }
+
+      return node;
+   }
+
+   return ParseComparison();
+}
+
+Filter::Node * Filter::ParseComparison()
+{
+   std::string const tag = Next();
+   uint32_t          id  = 0;
+
+   for (; (id < TagCount) && ((IsQuoted(tag) == true) || (Lower(tag) != Tags[id].name)); ++id) { }
+
+   if (id == TagCount)
+   {
+      error_ = (tag == "") ? "expected a tag" : "unknown tag '" + Unquote(tag) + "'";
+      return NULL;
+   }
+
+   std::string const op = Lower(Next());
+   Node * node = new Node(Node::Compare);
+   node->tag_  = id;
+
+   if      (op == "==")       { node->op_ = Node::Equal; }
+   else if (op == "!=")       { node->op_ = Node::NotEqual; }
+   else if (op == "contains") { node->op_ = Node::Contains; }
+   else if (op == "=~")       { node->op_ = Node::Match; }
+   else if (op == "!~")       { node->op_ = Node::NotMatch; }
+   else
+   {
+      error_ = "expected ==, !=, contains, =~ or !~ after '" + Unquote(tag) + "'";
+      delete node;
+      return NULL;
+   }
+
+   std::string const value = Next();
+
+   if ((value == "") || (value == "(") || (value == ")"))
+   {
+      error_ = "expected a value after '" + op + "'";
+      delete node;
+      return NULL;
+   }
+
+   node->value_ = Unquote(value);
+
+   if ((node->op_ == Node::Match) || (node->op_ == Node::NotMatch))
+   {
+      node->regex_ = new Regex::RE(node->value_, Regex::CaseInsensitive);
+   }
+
+   return node;
+}
+
+
+std::string Filter::Next()
+{
+   while ((position_ < query_.size()) && (isspace(query_[position_]) != 0))
+   {
+      ++position_;
+   }
+
+   if (position_ >= query_.size())
+   {
+      return "";
+   }
+
+   char const c = query_[position_];
+
+   if ((c == '(') || (c == ')'))
+   {
+      return std::string(1, query_[position_++]);
+   }
+   else if ((c == '"') || (c == '\''))
+   {
+      std::string token(1, c);
+
+      for (++position_; (position_ < query_.size()) && (query_[position_] != c); ++position_)
+      {
+         if ((query_[position_] == '\\') && (position_ + 1 < query_.size()))
+         {
+            ++position_;
+         }
+
+         token += query_[position_];
+      }
+
+      ++position_;
+      return token;
+   }
+   else if ((c == '=') || (c == '!') || (c == '&') || (c == '|'))
+   {
+      std::string const Pair = query_.substr(position_, 2);
+
+      if ((Pair == "==") || (Pair == "!=") || (Pair == "=~") || (Pair == "!~") || (Pair == "&&") || (Pair == "||"))
+      {
+         position_ += 2;
+         return Pair;
+      }
+
+      return std::string(1, query_[position_++]);
+   }
+
+   size_t const Start = position_;
+
+   while ((position_ < query_.size()) && (isspace(query_[position_]) == 0) &&
+          (std::string("()\"'=!").find(query_[position_]) == std::string::npos))
+   {
+      ++position_;
+   }
+
+   return query_.substr(Start, position_ - Start);
+}
+
+std::string Filter::Peek()
+{
+   size_t const Position = position_;
+   std::string const token = Next();
+   position_ = Position;
+   return token;
+}
+
+
+std::string Filter::Expression(Node const * node, bool contains) const
+{
+   static char const * const Operators[] = { "==", "!=", "contains", "=~", "!~" };
+
+   switch (node->type_)
+   {
+      case Node::Compare:
+      {
+         bool const        Rewrite  = ((node->op_ == Node::Contains) && (contains == false));
+         std::string const Operator = (Rewrite == true) ? "=~" : Operators[node->op_];
+         std::string value;
+
+         for (auto c : (Rewrite == true) ? RegexEscape(node->value_) : node->value_)
+         {
+            if ((c == '"') || (c == '\'') || (c == '\\'))
+            {
+               value += '\\';
+            }
+
+            value += c;
+         }
+
+         return std::string("(") + Tags[node->tag_].mpd + " " + Operator + " \"" + value + "\")";
+      }
+
+      case Node::And:
+         return "(" + Expression(node->left_, contains) + " AND " + Expression(node->right_, contains) + ")";
+
+      case Node::Or:
+         return "(!((!" + Expression(node->left_, contains) + ") AND (!" + Expression(node->right_, contains) + ")))";
+
+      case Node::Not:
+         return "(!" + Expression(node->left_, contains) + ")";
+   }
+
+   return "";
+}
+
+bool Filter::Matches(Node const * node, Mpc::Song const & song) const
+{
+   switch (node->type_)
+   {
+      case Node::Compare:
+      {
+         bool matched = false;
+
+         // A negated comparison of any tag only holds if none of them match
+         for (uint32_t i = 1; (i < TagCount) && (matched == false); ++i)
+         {
+            if (((node->tag_ == 0) && (i != FileTag)) || (node->tag_ == i))
+            {
+               std::string const & Value = (song.*Tags[i].function)();
+
+               if ((node->op_ == Node::Equal) || (node->op_ == Node::NotEqual) || (node->op_ == Node::Contains))
+               {
+                  // mpd's search matches part of the tag for == as well
+                  matched = (Lower(Value).find(Lower(node->value_)) != std::string::npos);
+               }
+               else
+               {
+                  matched = node->regex_->Matches(Value);
+               }
+            }
+         }
+
+         return ((node->op_ == Node::NotEqual) || (node->op_ == Node::NotMatch)) ? !matched : matched;
+      }
+
+      case Node::And:
+         return (Matches(node->left_, song) && Matches(node->right_, song));
+
+      case Node::Or:
+         return (Matches(node->left_, song) || Matches(node->right_, song));
+
+      case Node::Not:
+         return !Matches(node->left_, song);
+   }
+
+   return false;
+}
+/* vim: set sw=3 ts=3: */
@@ -0,0 +1,79 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   filter.hpp - compound queries over song tags
+   */
+
+#ifndef __MPC__FILTER
+#define __MPC__FILTER
+
+// Includes
+#include <string>
+
+// Forward Declarations
+namespace Mpc { class Song; }
+
+// A query such as: artist == "Foo" and (album contains bar or not genre =~ "^Rock")
+namespace Mpc
+{
+   class Filter
+   {
+   public:
+      Filter(std::string const & query);
+      ~Filter();
+
+   private:
+      Filter(Filter const & filter);
+      Filter & operator=(Filter const & filter);
+
+   public:
+      bool Valid() const                { return (root_ != NULL); }
+      std::string const & Error() const { return error_; }
+
+      //! The query as an mpd 0.21 filter expression, or is written
+      //! using not and and since mpd does not provide it, contains is
+      //! only understood from mpd 0.24 so is otherwise written as a regex
+      std::string Expression(bool contains) const;
+
+      //! Evaluate the query against a song in the same way mpd's search
+      //! would, == is a substring match as it is before mpd 0.24
+      bool Matches(Mpc::Song const & song) const;
+
+   private:
+      struct Node;
+
+      Node * ParseOr();
+      Node * ParseAnd();
+      Node * ParseNot();
+      Node * ParseComparison();
+
+      std::string Next();
+      std::string Peek();
+
+      std::string Expression(Node const * node, bool contains) const;
+      bool Matches(Node const * node, Mpc::Song const & song) const;
+
+   private:
+      std::string query_;
+      size_t      position_;
+      std::string error_;
+      Node *      root_;
+   };
+}
+
+#endif
+/* vim: set sw=3 ts=3: */
@@ -0,0 +1,302 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   librarycache.cpp - on disk snapshot of the mpd database
+   */
+
+#include "librarycache.hpp"
+
+#include "song.hpp"
+#include "window/debug.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+using namespace Mpc;
+
+// Increment whenever the layout of the file or a song changes
+static uint32_t    const CacheVersion = 2;
+static char        const CacheMagic[] = "VIMPCLIB";
+static std::string const CacheSuffix  = ".library";
+
+// A longer string means the cache is corrupt, and a corrupt song count
+// is only trusted this far when reserving space
+static uint32_t    const MaxStringLength = 64 * 1024;
+static uint32_t    const MaxReserve      = 1024 * 1024;
+
+static bool MakeDirectory(std::string const & path)
+{
+   return ((mkdir(path.c_str(), 0755) == 0) || (errno == EEXIST));
+}
+
+template <typename T>
+static void Write(std::ostream & stream, T const & value)
+{
+   stream.write(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool Read(std::istream & stream, T & value)
+{
+   return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+static void WriteString(std::ostream & stream, std::string const & value)
+{
+   Write<uint32_t>(stream, value.size());
+   stream.write(value.data(), value.size());
+}
+
+static bool ReadString(std::istream & stream, std::string & value)
+{
+   uint32_t Length = 0;
+
+   if ((Read(stream, Length) == true) && (Length <= MaxStringLength))
+   {
+      value.resize(Length);
+      return ((Length == 0) || (stream.read(&value[0], Length)));
+   }
+
+   return false;
+}
+
+
+LibraryCache::LibraryCache(std::string const & hostname, uint16_t port) :
+   key_  (hostname + ":" + std::to_string(port)),
+   path_ ("")
+{
+   char const * const home_dir      = getenv("HOME");
+   char const * const xdg_cache_dir = getenv("XDG_CACHE_HOME");
+
+   std::string directory;
+
+   if ((xdg_cache_dir != NULL) && (*xdg_cache_dir != '\0'))
+   {
+      directory = xdg_cache_dir;
+   }
+   else if (home_dir != NULL)
+   {
+      directory = std::string(home_dir).append("/.cache");
+   }
+
+   if ((directory.empty() == false) &&
+       (MakeDirectory(directory) == true) &&
+       (MakeDirectory(directory.append("/vimpc")) == true))
+   {
+      // Socket paths contain slashes, so flatten the host into a file name
+      std::string name = key_;
+
+      for (auto & c : name)
+      {
+         if ((c == '/') || (c == ':'))
+         {
+            c = '_';
+         }
+      }
+
+      path_ = directory + "/" + name + CacheSuffix;
+   }
+}
+
+LibraryCache::~LibraryCache()
+{ }
+
+
+bool LibraryCache::Load(uint64_t dbUpdate, uint32_t dbSongs, std::vector<Mpc::Song *> & songs,
+                        std::vector<std::string> & paths, ListFiles & lists) const
+{
+   if (path_.empty() == true)
+   {
+      return false;
+   }
+
+   std::ifstream stream(path_.c_str(), std::ios::in | std::ios::binary);
+
+   if (!stream)
+   {
+      return false;
+   }
+
+   char        Magic[sizeof(CacheMagic)] = { 0 };
+   uint32_t    Version  = 0;
+   uint64_t    DBUpdate = 0;
+   uint32_t    DBSongs  = 0;
+   std::string Key;
+
+   stream.read(Magic, sizeof(CacheMagic));
+
+   if ((!stream) ||
+       (std::string(Magic) != CacheMagic) ||
+       (Read(stream, Version) == false) || (Version  != CacheVersion) ||
+       (Read(stream, DBUpdate) == false) || (DBUpdate != dbUpdate) ||
+       (Read(stream, DBSongs)  == false) || (DBSongs  != dbSongs)  ||
+       (ReadString(stream, Key) == false) || (Key != key_))
+   {
+      Debug("LibraryCache::Cache %s is out of date", path_.c_str());
+      return false;
+   }
+
+   uint32_t Count = 0;
+   bool     Valid = Read(stream, Count);
+
+   std::vector<Mpc::Song *> Songs;
+   Songs.reserve(std::min(Count, MaxReserve));
+
+   for (uint32_t i = 0; (Valid == true) && (i < Count); ++i)
+   {
+      Mpc::Song * const song = new Mpc::Song();
+      Songs.push_back(song);
+      Valid = song->Deserialise(stream);
+   }
+
+   std::vector<std::string> Paths;
+   Valid = (Valid == true) && (Read(stream, Count) == true);
+
+   for (uint32_t i = 0; (Valid == true) && (i < Count); ++i)
+   {
+      std::string Path;
+      Valid = ReadString(stream, Path);
+      Paths.push_back(Path);
+   }
+
+   ListFiles Lists;
+   Valid = (Valid == true) && (Read(stream, Count) == true);
+
+   for (uint32_t i = 0; (Valid == true) && (i < Count); ++i)
+   {
+      std::string Name, Path;
+      Valid = (ReadString(stream, Name) == true) && (ReadString(stream, Path) == true);
+      Lists.push_back(std::make_pair(Name, Path));
+   }
+
+   if (Valid == false)
+   {
+      Debug("LibraryCache::Cache %s is corrupt", path_.c_str());
+
+      for (auto song : Songs)
+      {
+         delete song;
+      }
+
+      return false;
+   }
+
+   Debug("LibraryCache::Loaded %u songs from %s", static_cast<uint32_t>(Songs.size()), path_.c_str());
+
+   songs.insert(songs.end(), Songs.begin(), Songs.end());
+   paths.insert(paths.end(), Paths.begin(), Paths.end());
+   lists.insert(lists.end(), Lists.begin(), Lists.end());
+   return true;
+}
+
+bool LibraryCache::Save(uint64_t dbUpdate, uint32_t dbSongs, std::vector<Mpc::Song *> const & songs,
+                        std::vector<std::string> const & paths, ListFiles const & lists) const
+{
+   if (path_.empty() == true)
+   {
+      return false;
+   }
+
+   // Write to a temporary file first so that a partially written
+   // cache is never picked up by another instance, the name is unique
+   // so that two instances saving at once don't write to the same file
+   std::vector<char> Template(path_.begin(), path_.end());
+   std::string const Suffix(".XXXXXX");
+   Template.insert(Template.end(), Suffix.begin(), Suffix.end());
+   Template.push_back('\0');
+
+   int const fd = mkstemp(&Template[0]);
+
+   if (fd == -1)
+   {
+      return false;
+   }
+
+   close(fd);
+
+   std::string const Temporary(&Template[0]);
+
+   {
+      std::ofstream stream(Temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+      if (!stream)
+      {
+         remove(Temporary.c_str());
+         return false;
+      }
+
+      stream.write(CacheMagic, sizeof(CacheMagic));
+      Write<uint32_t>(stream, CacheVersion);
+      Write<uint64_t>(stream, dbUpdate);
+      Write<uint32_t>(stream, dbSongs);
+      WriteString(stream, key_);
+
+      Write<uint32_t>(stream, songs.size());
+
+      for (auto song : songs)
+      {
+         song->Serialise(stream);
+      }
+
+      Write<uint32_t>(stream, paths.size());
+
+      for (auto const & path : paths)
+      {
+         WriteString(stream, path);
+      }
+
+      Write<uint32_t>(stream, lists.size());
+
+      for (auto const & list : lists)
+      {
+         WriteString(stream, list.first);
+         WriteString(stream, list.second);
+      }
+
+      stream.flush();
+
+      if (!stream)
+      {
+         stream.close();
+         remove(Temporary.c_str());
+         return false;
+      }
+   }
+
+   Debug("LibraryCache::Saved %u songs to %s", static_cast<uint32_t>(songs.size()), path_.c_str());
+
+   if (rename(Temporary.c_str(), path_.c_str()) != 0)
+   {
+      remove(Temporary.c_str());
+      return false;
+   }
+
+   return true;
+}
+
+std::string const & LibraryCache::Path() const
+{
+   return path_;
+}
+
+/* vim: set sw=3 ts=3: */
@@ -0,0 +1,65 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   librarycache.hpp - on disk snapshot of the mpd database
+   */
+
+#ifndef __MPC__LIBRARYCACHE
+#define __MPC__LIBRARYCACHE
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Mpc
+{
+   class Song;
+
+   typedef std::vector<std::pair<std::string, std::string> > ListFiles;
+
+   //! Stores the result of a listallinfo so that it does not need to be
+   //! requested again on the next start up unless the database has changed
+   class LibraryCache
+   {
+   public:
+      LibraryCache(std::string const & hostname, uint16_t port);
+      ~LibraryCache();
+
+   private:
+      LibraryCache(LibraryCache const & cache);
+      LibraryCache & operator=(LibraryCache const & cache);
+
+   public:
+      //! Loads the snapshot if it was taken of the given database version,
+      //! the created songs are owned by the caller. The update time only
+      //! has a resolution of a second so the song count has to match too
+      bool Load(uint64_t dbUpdate, uint32_t dbSongs, std::vector<Mpc::Song *> & songs,
+                std::vector<std::string> & paths, ListFiles & lists) const;
+
+      bool Save(uint64_t dbUpdate, uint32_t dbSongs, std::vector<Mpc::Song *> const & songs,
+                std::vector<std::string> const & paths, ListFiles const & lists) const;
+
+      std::string const & Path() const;
+
+   private:
+      std::string key_;
+      std::string path_;
+   };
+}
+
+#endif
+/* vim: set sw=3 ts=3: */
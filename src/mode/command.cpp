@@ -23,6 +23,7 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <fstream>
 #include <sstream>
 
 #ifdef HAVE_TAGLIB_H
@@ -42,8 +43,11 @@
 #include "algorithm.hpp"
 #include "assert.hpp"
 #include "buffers.hpp"
+#include "filter.hpp"
 #include "regex.hpp"
 #include "settings.hpp"
+#include "songsorter.hpp"
+#include "stats.hpp"
 #include "tag.hpp"
 #include "vimpc.hpp"
 
@@ -51,6 +55,7 @@
 #include "buffer/list.hpp"
 #include "buffer/outputs.hpp"
 #include "buffer/playlist.hpp"
+#include "buffer/servers.hpp"
 #include "mode/normal.hpp"
 #include "window/console.hpp"
 #include "window/debug.hpp"
@@ -114,6 +119,8 @@ Command::Command(Main::Vimpc * vimpc, Ui::Screen & screen, Mpc::Client & client,
    AddCommand("findartist", true,  false, &Command::FindArtist);
    AddCommand("findgenre",  true,  false, &Command::FindGenre);
    AddCommand("findsong",   true,  false, &Command::FindSong);
+   AddCommand("filter",     true,  false, &Command::Filter);
+   AddCommand("monitor",    false, false, &Command::Monitor);
    AddCommand("move",       true,  true,  &Command::Move);
    AddCommand("mute",       true,  false, &Command::Mute);
    AddCommand("nohlsearch", false, false, &Command::NoHighlightSearch);
@@ -136,6 +143,7 @@ Command::Command(Main::Vimpc * vimpc, Ui::Screen & screen, Mpc::Client & client,
    AddCommand("single",     true,  false, &Command::Single);
    AddCommand("shuffle",    true,  false, &Command::Shuffle);
    AddCommand("sleep",      false, false, &Command::Sleep);
+   AddCommand("stats",      false, false, &Command::Stats);
 #ifdef TAG_SUPPORT
    AddCommand("substitute", false, true,  &Command::Substitute);
    AddCommand("s",          false, true,  &Command::Substitute);
@@ -167,6 +175,7 @@ Command::Command(Main::Vimpc * vimpc, Ui::Screen & screen, Mpc::Client & client,
    AddCommand("highlight",  false, false, &Command::SetColour);
 
    AddCommand("rescan",     true,  false, &Command::Rescan);
+   AddCommand("unmonitor",  false, false, &Command::Unmonitor);
    AddCommand("update",     true,  false, &Command::Update);
 
    AddCommand("next",       true,  false, &Command::SkipSong<Player::Next>);
@@ -179,6 +188,7 @@ Command::Command(Main::Vimpc * vimpc, Ui::Screen & screen, Mpc::Client & client,
    AddCommand("directory",   true,  false, &Command::SetActiveAndVisible<Ui::Screen::Directory>);
    AddCommand("playlist",    true,  false, &Command::SetActiveAndVisible<Ui::Screen::Playlist>);
    AddCommand("outputs",     true,  false, &Command::SetActiveAndVisible<Ui::Screen::Outputs>);
+   AddCommand("servers",     false, false, &Command::SetActiveAndVisible<Ui::Screen::Servers>);
    AddCommand("lists",       true,  false, &Command::SetActiveAndVisible<Ui::Screen::Lists>);
    AddCommand("windowselect",false, false, &Command::SetActiveAndVisible<Ui::Screen::WindowSelect>);
 
@@ -675,6 +685,55 @@ void Command::Connect(std::string const & arguments)
    }
 }
 
+void Command::Monitor(std::string const & arguments)
+{
+   size_t   pos  = arguments.find_first_of(" ");
+   uint32_t port = 0;
+
+   std::string hostname = arguments.substr(0, pos);
+
+   if (pos != std::string::npos)
+   {
+      port = atoi(arguments.substr(pos + 1).c_str());
+   }
+
+   if (hostname == "")
+   {
+      hostname = "localhost";
+   }
+
+   if (Main::Servers().Find(hostname, port) == NULL)
+   {
+      Main::Servers().Add(new Mpc::Server(hostname, port));
+   }
+}
+
+void Command::Unmonitor(std::string const & arguments)
+{
+   size_t   pos  = arguments.find_first_of(" ");
+   uint32_t port = 0;
+
+   std::string hostname = arguments.substr(0, pos);
+
+   if (pos != std::string::npos)
+   {
+      port = atoi(arguments.substr(pos + 1).c_str());
+   }
+
+   if (hostname == "")
+   {
+      hostname = "localhost";
+   }
+
+   Mpc::Server * const server = Main::Servers().Find(hostname, port);
+
+   if (server != NULL)
+   {
+      Main::Servers().Remove(Main::Servers().Index(server), 1);
+      delete server;
+   }
+}
+
 void Command::Disconnect(std::string const & arguments)
 {
    client_.Disconnect();
@@ -711,6 +770,10 @@ void Command::EchoError(std::string const & arguments)
 void Command::Sleep(std::string const & seconds)
 {
    vimpc_->ChangeMode('\n', "");
+
+   // Start counting from when the commands before the sleep have
+   // actually been run rather than when they were queued
+   client_.WaitForCompletion();
    usleep(1000 * 1000 * atoi(seconds.c_str()));
 }
 
@@ -972,6 +1035,56 @@ void Command::FindSong(std::string const & arguments)
    Find("F:" + arguments);
 }
 
+void Command::Filter(std::string const & arguments)
+{
+   Mpc::Filter const filter(arguments);
+
+   if (filter.Valid() == false)
+   {
+      ErrorString(ErrorNumber::InvalidParameter, filter.Error());
+   }
+   else if (client_.SupportsFilters() == true)
+   {
+      client_.SearchExpression(filter.Expression(client_.SupportsContains()));
+      Find("F:" + arguments);
+   }
+   else
+   {
+      // Older servers cannot evaluate the query, so it is run over the library instead
+      std::vector<Mpc::Song *> songs;
+
+      Main::Library().ForEachSong([&filter, &songs] (Mpc::Song * song)
+      {
+         if (filter.Matches(*song) == true)
+         {
+            songs.push_back(song);
+         }
+      });
+
+      if (songs.empty() == true)
+      {
+         ErrorString(ErrorNumber::FindNoResults);
+      }
+      else if (forceCommand_ == true)
+      {
+         client_.Add(songs);
+      }
+      else
+      {
+         Ui::SongWindow * const window = screen_.CreateSongWindow("F:" + arguments);
+
+         for (auto song : songs)
+         {
+            window->Add(song);
+         }
+
+         Ui::SongSorter const sorter(settings_.Get(::Setting::Sort));
+         window->Buffer().Sort(sorter);
+         screen_.SetActiveAndVisible(screen_.GetWindowFromName(window->Name()));
+      }
+   }
+}
+
 void Command::PrintMappings(std::string tabname)
 {
    Ui::Normal::MapNameTable mappings = normalMode_.Mappings();
@@ -1638,6 +1751,40 @@ void Command::Set(std::string const & arguments)
    }
 }
 
+void Command::Stats(std::string const & arguments)
+{
+   if (forceCommand_ == true)
+   {
+      Main::Stats::Instance().Reset();
+   }
+   else if (arguments != "")
+   {
+      std::ofstream stream(arguments.c_str(), std::ios::out | std::ios::trunc);
+
+      if (stream.is_open() == true)
+      {
+         stream << Main::Stats::Instance().Json() << std::endl;
+      }
+
+      if ((stream.is_open() == false) || (stream.fail() == true))
+      {
+         ErrorString(ErrorNumber::FileNotWritten, arguments);
+      }
+   }
+   else
+   {
+      PagerWindow * const pager = screen_.GetPagerWindow();
+      pager->Clear();
+
+      for (auto line : Main::Stats::Instance().Lines())
+      {
+         pager->AddLine(line);
+      }
+
+      screen_.ShowPagerWindow();
+   }
+}
+
 void Command::Mpc(std::string const & arguments)
 {
    static uint32_t const bufferSize = 512;
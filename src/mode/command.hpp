@@ -116,6 +116,13 @@ namespace Ui
       void Disconnect(std::string const & arguments);
       void Reconnect(std::string const & arguments);
 
+      //! Show the status of another host in the servers window
+      //!
+      //! \param host The hostname to monitor
+      //! \param port The port to connect with
+      void Monitor(std::string const & arguments);
+      void Unmonitor(std::string const & arguments);
+
       void NoHighlightSearch(std::string const & arguments);
 
       //! Execute the input as a normal mode command
@@ -164,6 +171,7 @@ namespace Ui
       void FindArtist(std::string const & arguments);
       void FindGenre(std::string const & arguments);
       void FindSong(std::string const & arguments);
+      void Filter(std::string const & arguments);
 
       void PrintMappings(std::string tabname = "");
       void Map(std::string const & arguments);
@@ -234,6 +242,9 @@ namespace Ui
       // Handle the settings
       void Set(std::string const & arguments);
 
+      // Show event and command timings, or write them to a file as json
+      void Stats(std::string const & arguments);
+
       // Call the cli mpc client
       void Mpc(std::string const & arguments);
 
@@ -1503,6 +1503,13 @@ std::string Normal::StateString()
       updating += " [Updating]";
    }
 
+   if (clientState_.IsLoading() == true)
+   {
+      char songs[16];
+      snprintf(songs, 16, "%u", clientState_.LoadedSongs());
+      updating += " [Loading: " + std::string(songs) + " songs]";
+   }
+
    std::string const currentState("[State: " + clientState_.CurrentState() + "]" + volume + toggles + updating);
    return currentState;
 }
@@ -21,6 +21,7 @@
 #include "search.hpp"
 
 #include "algorithm.hpp"
+#include "events.hpp"
 #include "settings.hpp"
 #include "vimpc.hpp"
 #include "buffer/playlist.hpp"
@@ -44,6 +45,21 @@ Search::Search(Ui::Screen & screen, Mpc::Client & client, Main::Settings & setti
 {
    prompt_[Forwards]  = '/';
    prompt_[Backwards] = '?';
+
+   pending_.request = 0;
+
+   Main::Vimpc::EventHandler(Event::TagsApplied, [this] (EventData const & Data)
+   {
+      if ((pending_.request != 0) && (pending_.request == Data.id))
+      {
+         pending_.request = 0;
+
+         if (screen_.GetActiveWindow() == pending_.window)
+         {
+            (void) FindResult(pending_.skip, pending_.search, pending_.line, pending_.count, pending_.raiseError);
+         }
+      }
+   });
 }
 
 Search::~Search()
@@ -142,6 +158,28 @@ bool Search::SearchResult(Skip skip, uint32_t count)
 }
 
 bool Search::SearchResult(Skip skip, std::string const & search, int32_t line, uint32_t count, bool raiseError)
+{
+   // Every song that might match needs its tags, the search is
+   // run once they have arrived rather than waiting for them here
+   uint32_t const Request = screen_.ActiveWindow().FetchTags(0, screen_.ActiveWindow().BufferSize(), true);
+
+   if (Request != 0)
+   {
+      pending_.request    = Request;
+      pending_.window     = screen_.GetActiveWindow();
+      pending_.skip       = skip;
+      pending_.search     = search;
+      pending_.line       = line;
+      pending_.count      = count;
+      pending_.raiseError = raiseError;
+      return true;
+   }
+
+   pending_.request = 0;
+   return FindResult(skip, search, line, count, raiseError);
+}
+
+bool Search::FindResult(Skip skip, std::string const & search, int32_t line, uint32_t count, bool raiseError)
 {
    bool found = false;
 
@@ -77,6 +77,7 @@ namespace Ui
 
    private:
       bool SearchResult(Skip skip, std::string const & search, int32_t line, uint32_t count, bool raiseError = true);
+      bool FindResult(Skip skip, std::string const & search, int32_t line, uint32_t count, bool raiseError);
       bool SearchWindow(Direction direction, std::string search, int32_t startLine, uint32_t count);
       bool SearchForResult(Direction direction, std::string search, uint32_t count, int32_t startLine);
       Direction SwapDirection(Direction direction) const;
@@ -101,6 +102,18 @@ namespace Ui
       Main::Settings &    settings_;
       Ui::Screen     &    screen_;
 
+      // A search that is waiting for the tags of lazily listed songs
+      struct
+      {
+         uint32_t         request;
+         int32_t          window;
+         Skip             skip;
+         std::string      search;
+         int32_t          line;
+         uint32_t         count;
+         bool             raiseError;
+      } pending_;
+
   };
 }
 
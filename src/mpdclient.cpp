@@ -22,10 +22,14 @@
 
 #include "assert.hpp"
 #include "events.hpp"
+#include "librarycache.hpp"
+#include "responseparser.hpp"
 #include "screen.hpp"
 #include "settings.hpp"
+#include "stats.hpp"
 #include "vimpc.hpp"
 
+#include "buffer/directory.hpp"
 #include "buffer/playlist.hpp"
 #include "buffer/list.hpp"
 #include "mode/mode.hpp"
@@ -36,9 +40,20 @@
 #include <poll.h>
 #include <unistd.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <algorithm>
 #include <list>
+#include <map>
+#include <set>
+#include <netdb.h>
 #include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
 
 using namespace Mpc;
 
@@ -46,10 +61,136 @@ using namespace Mpc;
 //#define _DEBUG_ASSERT_ON_ERROR
 //#define _DEBUG_BREAK_ON_ERROR
 
-static std::list<FUNCTION<void()> >       Queue;
-static Mutex                              QueueMutex;
+static CommandQueue                       Queue;
+static CommandQueue                       InteractiveQueue;
+
+// The interactive command that is due to run next, it is held here until
+// every normal command that was queued before it has been started
+static struct
+{
+   bool                                   held;
+   FUNCTION<void()>                       command;
+   CompletionHandle                       completion;
+   uint64_t                               after;
+} NextInteractive = { false, FUNCTION<void()>(), CompletionHandle(), 0 };
+
+// Only to be called from the client thread
+static bool InteractiveReady()
+{
+   if (NextInteractive.held == false)
+   {
+      bool batchable = false;
+      NextInteractive.held = InteractiveQueue.Pop(NextInteractive.command, NextInteractive.completion,
+                                                  batchable, NextInteractive.after);
+   }
+
+   return ((NextInteractive.held == true) && (NextInteractive.after <= Queue.Popped()));
+}
+
+static bool InteractiveEmpty()
+{
+   return ((NextInteractive.held == false) && (InteractiveQueue.Empty() == true));
+}
+
+// Bulk adds are sent in command lists of this many songs, interactive
+// commands get a chance to run between each one
+static size_t const AddChunkSize = 512;
 static Atomic(bool)                       Running(true);
-static ConditionVariable                  Condition;
+
+// The executor blocks in poll on this pipe as well as the mpd sockets,
+// a byte is written to it whenever there is something new to do
+static int                                WakeupPipe[2] = { -1, -1 };
+
+static bool OpenWakeupPipe()
+{
+   if (pipe(WakeupPipe) == 0)
+   {
+      for (int i = 0; i < 2; ++i)
+      {
+         fcntl(WakeupPipe[i], F_SETFD, FD_CLOEXEC);
+         fcntl(WakeupPipe[i], F_SETFL, fcntl(WakeupPipe[i], F_GETFL) | O_NONBLOCK);
+      }
+
+      return true;
+   }
+
+   return false;
+}
+
+static void Wakeup()
+{
+   char const Byte = 0;
+
+   // If the pipe is full the executor is going to wake up anyway
+   if (write(WakeupPipe[1], &Byte, 1) < 0) { }
+}
+
+static void DrainWakeups()
+{
+   char Buffer[64];
+
+   while (read(WakeupPipe[0], Buffer, sizeof(Buffer)) > 0) { }
+}
+
+static void WaitForWakeup(int timeoutMs)
+{
+   pollfd fds = { WakeupPipe[0], POLLIN, 0 };
+
+   if (poll(&fds, 1, timeoutMs) > 0)
+   {
+      DrainWakeups();
+   }
+}
+
+static bool const WakeupPipeOpen = OpenWakeupPipe();
+
+// Resolved addresses are cached by host and port so that connecting to
+// the same server again does not have to wait on the resolver
+struct AddressCacheEntry
+{
+   bool                         resolved;
+   std::vector<ResolvedAddress> addresses;
+};
+
+static std::map<std::string, AddressCacheEntry> AddressCache;
+static Mutex                                    AddressMutex;
+
+static uint32_t const ConnectStepMs = 25;
+
+// Used when no timeout is configured, the same as libmpdclient's default
+static uint32_t const DefaultTimeoutMs = 30 * 1000;
+
+// Status is requested this often when the polling setting is on
+static long const PollIntervalMs = 900;
+
+// Ping the command connection when only the idle connection has been used for this long
+static long const KeepAliveMs = 30 * 1000;
+
+// A dropped connection is retried after this long, doubling each failed attempt
+static long const ReconnectMinMs = 250;
+static long const ReconnectMaxMs = 30 * 1000;
+
+// How far apart two calculations of the server's start time can be
+// whilst still being the same instance of mpd
+static time_t const ServerStartSlack = 5;
+
+// Updates are sent once no more have been requested for this long
+static long const UpdateDelayMs = 300;
+
+// A batch of updates touching more directories than this updates their common ancestor
+static size_t const UpdateMaxPaths = 16;
+
+// Number of songs sent to the buffers in each database event
+static size_t const DatabaseBatchSize = 4096;
+
+// Tags for lazily listed songs are requested in command lists of this many songs
+static size_t const TagBatchSize = 128;
+
+// Search results are requested in pages of this many songs when mpd supports it
+static uint32_t const SearchPageSize = 256;
+
+// Queue ids that are not known are looked up in command lists of this many ids
+static size_t const QueueLookupBatchSize = 128;
 
 
 // Helper functions
@@ -63,6 +204,70 @@ uint32_t Mpc::RemainingSeconds(uint32_t duration)
    return (duration - (SecondsToMinutes(duration) * 60));
 }
 
+static std::string ParentPath(std::string const & path)
+{
+   size_t const Slash = path.rfind('/');
+   return (Slash != std::string::npos) ? path.substr(0, Slash) : "";
+}
+
+std::vector<std::string> Mpc::UpdateRoots(std::vector<std::string> const & paths, size_t maxPaths)
+{
+   std::set<std::string> const Unique(paths.begin(), paths.end());
+   std::map<std::string, uint32_t> siblings;
+   std::set<std::string> candidates;
+
+   if (Unique.find("") != Unique.end())
+   {
+      return std::vector<std::string>(1, "");
+   }
+
+   for (auto const & Path : Unique)
+   {
+      ++siblings[ParentPath(Path)];
+   }
+
+   // Never widen to the root, that would list the whole database again
+   for (auto const & Path : Unique)
+   {
+      std::string const Parent = ParentPath(Path);
+      candidates.insert(((Parent != "") && (siblings[Parent] > 1)) ? Parent : Path);
+   }
+
+   std::vector<std::string> roots;
+
+   for (auto const & Path : candidates)
+   {
+      // Sorted, so a containing directory comes straight before what it contains
+      if ((roots.empty() == true) ||
+          (Path.compare(0, roots.back().size() + 1, roots.back() + "/") != 0))
+      {
+         roots.push_back(Path);
+      }
+   }
+
+   if (roots.size() > maxPaths)
+   {
+      std::string ancestor = roots.front();
+
+      for (auto const & Path : roots)
+      {
+         while ((ancestor != "") && (Path != ancestor) &&
+                (Path.compare(0, ancestor.size() + 1, ancestor + "/") != 0))
+         {
+            ancestor = ParentPath(ancestor);
+         }
+      }
+
+      // Without a common ancestor the paths are kept, they are sent in several lists
+      if (ancestor != "")
+      {
+         roots = std::vector<std::string>(1, ancestor);
+      }
+   }
+
+   return roots;
+}
+
 
 CommandList::CommandList(Mpc::Client & client, bool condition) :
    condition_(condition),
@@ -87,6 +292,273 @@ CommandList::~CommandList()
 }
 
 
+// Mpc::PendingConnection Implementation
+//
+// Holds the state of a connection that is being established, the client
+// drives it forward one step at a time and hands the connected socket to
+// libmpdclient once the welcome message has been received
+PendingConnection::PendingConnection(std::string const & hostname, uint16_t port, uint32_t timeout_ms, std::string const & password) :
+   state_    (Resolving),
+   hostname_ (hostname),
+   port_     ((port != 0) ? port : 6600),
+   timeout_  (timeout_ms),
+   password_ (password),
+   key_      (hostname_ + ":" + std::to_string(port_)),
+   next_     (0),
+   fd_       (-1),
+   welcome_  ("")
+{
+   gettimeofday(&start_, NULL);
+}
+
+PendingConnection::~PendingConnection()
+{
+   CloseSocket();
+}
+
+bool PendingConnection::StartResolve()
+{
+   if ((hostname_.empty() == false) && (hostname_[0] == '/'))
+   {
+      // Local socket, nothing to resolve
+      ResolvedAddress Local;
+      struct sockaddr_un * Address = reinterpret_cast<struct sockaddr_un *>(&Local.address);
+
+      memset(&Local, 0, sizeof(Local));
+      Address->sun_family = AF_UNIX;
+      strncpy(Address->sun_path, hostname_.c_str(), sizeof(Address->sun_path) - 1);
+
+      Local.family   = AF_UNIX;
+      Local.socktype = SOCK_STREAM;
+      Local.protocol = 0;
+      Local.length   = sizeof(struct sockaddr_un);
+
+      addresses_.push_back(Local);
+      return true;
+   }
+
+   UniqueLock<Mutex> Lock(AddressMutex);
+
+   std::map<std::string, AddressCacheEntry>::iterator it = AddressCache.find(key_);
+
+   if (it != AddressCache.end())
+   {
+      if (it->second.resolved == true)
+      {
+         Debug("Client::Using cached address for %s", key_.c_str());
+         addresses_ = it->second.addresses;
+         return true;
+      }
+
+      // Someone else is already resolving this host
+      return false;
+   }
+
+   AddressCache[key_].resolved = false;
+
+   std::string const Key      = key_;
+   std::string const Hostname = hostname_;
+   std::string const Port     = std::to_string(port_);
+
+   // getaddrinfo blocks, so resolve on a separate thread that wakes
+   // the executor to carry on with the connection once it is done
+   Thread Resolver([Key, Hostname, Port] ()
+   {
+      struct addrinfo   Hints;
+      struct addrinfo * Result = NULL;
+
+      memset(&Hints, 0, sizeof(Hints));
+      Hints.ai_family   = AF_UNSPEC;
+      Hints.ai_socktype = SOCK_STREAM;
+
+      std::vector<ResolvedAddress> Addresses;
+
+      if (getaddrinfo(Hostname.c_str(), Port.c_str(), &Hints, &Result) == 0)
+      {
+         for (struct addrinfo * info = Result; info != NULL; info = info->ai_next)
+         {
+            if (info->ai_addrlen <= sizeof(struct sockaddr_storage))
+            {
+               ResolvedAddress Address;
+               memset(&Address, 0, sizeof(Address));
+               Address.family   = info->ai_family;
+               Address.socktype = info->ai_socktype;
+               Address.protocol = info->ai_protocol;
+               Address.length   = info->ai_addrlen;
+               memcpy(&Address.address, info->ai_addr, info->ai_addrlen);
+               Addresses.push_back(Address);
+            }
+         }
+
+         freeaddrinfo(Result);
+      }
+
+      {
+         UniqueLock<Mutex> Lock(AddressMutex);
+         AddressCacheEntry & Entry = AddressCache[Key];
+         Entry.resolved  = true;
+         Entry.addresses = Addresses;
+      }
+
+      Wakeup();
+   });
+
+   Resolver.detach();
+   return false;
+}
+
+bool PendingConnection::Resolved()
+{
+   UniqueLock<Mutex> Lock(AddressMutex);
+
+   std::map<std::string, AddressCacheEntry>::iterator it = AddressCache.find(key_);
+
+   if (it == AddressCache.end())
+   {
+      // The entry was dropped by a failed attempt, so resolve again
+      Lock.unlock();
+      return StartResolve();
+   }
+   else if (it->second.resolved == true)
+   {
+      addresses_ = it->second.addresses;
+
+      if (addresses_.empty() == true)
+      {
+         // Don't cache failures
+         AddressCache.erase(it);
+      }
+
+      return true;
+   }
+
+   return false;
+}
+
+void PendingConnection::ForgetAddresses()
+{
+   UniqueLock<Mutex> Lock(AddressMutex);
+   AddressCache.erase(key_);
+}
+
+bool PendingConnection::TimedOut() const
+{
+   return (TimeLeft() < 0);
+}
+
+long PendingConnection::TimeLeft() const
+{
+   struct timeval now;
+   gettimeofday(&now, NULL);
+
+   long const Elapsed = ((now.tv_sec - start_.tv_sec) * 1000) + ((now.tv_usec - start_.tv_usec) / 1000);
+
+   uint32_t const Limit = (timeout_ != 0) ? timeout_ : DefaultTimeoutMs;
+
+   return (static_cast<long>(Limit) - Elapsed);
+}
+
+bool PendingConnection::ConnectNextAddress()
+{
+   while (next_ < addresses_.size())
+   {
+      ResolvedAddress const & Address = addresses_[next_++];
+
+      fd_ = socket(Address.family, Address.socktype, Address.protocol);
+
+      if (fd_ != -1)
+      {
+         fcntl(fd_, F_SETFD, FD_CLOEXEC);
+         fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+
+         if ((connect(fd_, reinterpret_cast<struct sockaddr const *>(&Address.address), Address.length) == 0) ||
+             (errno == EINPROGRESS))
+         {
+            return true;
+         }
+
+         Debug("Client::Connect failed %s", strerror(errno));
+         CloseSocket();
+      }
+   }
+
+   return false;
+}
+
+int PendingConnection::WaitForConnect(uint32_t timeout_ms)
+{
+   pollfd fds;
+
+   fds.fd      = fd_;
+   fds.events  = POLLOUT;
+   fds.revents = 0;
+
+   int const Result = poll(&fds, 1, timeout_ms);
+
+   if (Result > 0)
+   {
+      int       Error  = 0;
+      socklen_t Length = sizeof(Error);
+
+      if ((getsockopt(fd_, SOL_SOCKET, SO_ERROR, &Error, &Length) != 0) || (Error != 0))
+      {
+         Debug("Client::Connect failed %s", strerror(Error));
+         return -1;
+      }
+
+      return 1;
+   }
+
+   return (Result < 0) ? -1 : 0;
+}
+
+int PendingConnection::ReadWelcome(uint32_t timeout_ms)
+{
+   pollfd fds;
+
+   fds.fd      = fd_;
+   fds.events  = POLLIN;
+   fds.revents = 0;
+
+   if (poll(&fds, 1, timeout_ms) > 0)
+   {
+      char Buffer[128];
+
+      ssize_t const Count = recv(fd_, Buffer, sizeof(Buffer), 0);
+
+      if (Count <= 0)
+      {
+         return ((Count < 0) && (errno == EAGAIN)) ? 0 : -1;
+      }
+
+      welcome_.append(Buffer, Count);
+
+      size_t const Newline = welcome_.find('\n');
+
+      if (Newline != std::string::npos)
+      {
+         // MPD will not send anything else until we send a command
+         // so there can't be anything else after the welcome
+         welcome_ = welcome_.substr(0, Newline);
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+void PendingConnection::CloseSocket()
+{
+   if (fd_ != -1)
+   {
+      close(fd_);
+      fd_ = -1;
+   }
+
+   welcome_ = "";
+}
+
+
 // Mpc::Client Implementation
 Client::Client(Main::Vimpc * vimpc, Main::Settings & settings, Mpc::Lists & lists, Ui::Screen & screen) :
    vimpc_                (vimpc),
@@ -99,8 +571,16 @@ Client::Client(Main::Vimpc * vimpc, Main::Settings & settings, Mpc::Lists & list
    versionMajor_         (-1),
    versionMinor_         (-1),
    versionPatch_         (-1),
+   filters_              (false),
+   contains_             (false),
    timeSinceUpdate_      (0),
-   retried_              (true),
+   reconnectDelay_       (0),
+   timeToReconnect_      (-1),
+   resync_               (false),
+   resyncVersion_        (-1),
+   dbUpdate_             (0),
+   dbSongs_              (0),
+   serverStarted_        (0),
    ready_                (false),
 
    volume_               (100),
@@ -128,6 +608,15 @@ Client::Client(Main::Vimpc * vimpc, Main::Settings & settings, Mpc::Lists & list
    loadedList_           (""),
 
    screen_               (screen),
+   connectId_            (0),
+   pending_              (NULL),
+   connectTimeout_       (0),
+   password_             (""),
+   idleConnectId_        (0),
+   idlePending_          (NULL),
+   idleConnection_       (NULL),
+   idleFd_               (-1),
+   timeSinceCommand_     (0),
    queueVersion_         (-1),
    oldVersion_           (-1),
    forceUpdate_          (true),
@@ -135,6 +624,18 @@ Client::Client(Main::Vimpc * vimpc, Main::Settings & settings, Mpc::Lists & list
    idleMode_             (false),
    queueUpdate_          (false),
    autoscroll_           (false),
+   pendingRescan_        (false),
+   timeToUpdate_         (-1),
+   updateJob_            (0),
+   searchTag_            (MPD_TAG_UNKNOWN),
+   searchTerm_           (""),
+   searchExpression_     (""),
+   searchName_           (""),
+   searchExact_          (false),
+   searchId_             (0),
+   searchOffset_         (0),
+   searchPending_        (false),
+   tagRequest_           (0),
    clientThread_         (Thread(&Client::ClientQueueExecutor, this, this))
 {
    screen_.RegisterProgressCallback([this] (double Value) { SeekToPercent(Value); });
@@ -143,7 +644,7 @@ Client::Client(Main::Vimpc * vimpc, Main::Settings & settings, Mpc::Lists & list
    {
       Mpc::CommandList list(*this);
 
-      for (auto uri : Data.uris)
+      for (auto uri : Data.Payload().uris)
       {
          Mpc::Song * song = Main::Library().Song(uri);
 
@@ -160,9 +661,28 @@ Client::Client(Main::Vimpc * vimpc, Main::Settings & settings, Mpc::Lists & list
 Client::~Client()
 {
    Running = false;
+   Wakeup();
 
    clientThread_.join();
 
+   // Nothing is going to run these now, release anybody waiting on them
+   {
+      FUNCTION<void()> function;
+      CompletionHandle completion;
+
+      if (NextInteractive.held == true)
+      {
+         NextInteractive.completion->Signal();
+         NextInteractive.held = false;
+      }
+
+      while ((InteractiveQueue.Pop(function, completion) == true) ||
+             (Queue.Pop(function, completion) == true))
+      {
+         completion->Signal();
+      }
+   }
+
    if (currentStatus_ != NULL)
    {
       mpd_status_free(currentStatus_);
@@ -175,34 +695,52 @@ Client::~Client()
       currentSong_ = NULL;
    }
 
+   CancelConnect();
    DeleteConnection();
 }
 
-void Client::QueueCommand(FUNCTION<void()> const & function)
+CompletionHandle Client::QueueCommand(FUNCTION<void()> const & function, Priority priority)
+{
+   // An interactive command must not overtake the normal commands queued before it
+   CompletionHandle const Handle = (priority == Interactive) ? InteractiveQueue.Push(function, false, Queue.Pushed()) : Queue.Push(function);
+   Wakeup();
+   return Handle;
+}
+
+CompletionHandle Client::QueueBatchableCommand(FUNCTION<void()> const & function)
 {
-   UniqueLock<Mutex> Lock(QueueMutex);
-   Queue.push_back(function);
-   Condition.notify_all();
+   CompletionHandle const Handle = Queue.Push(function, true);
+   Wakeup();
+   return Handle;
 }
 
 void Client::WaitForCompletion()
 {
-   QueueMutex.lock();
-   int Count = Queue.size();
-   QueueMutex.unlock();
+   // On the client thread this would wait on itself, and once the executor
+   // has stopped nothing is left to run the commands
+   ASSERT(ThisThread::get_id() != clientThread_.get_id());
 
-   while (Count != 0)
+   if ((Running == false) || (ThisThread::get_id() == clientThread_.get_id()))
    {
-      usleep(20 * 1000);
-      UniqueLock<Mutex> Lock(QueueMutex);
-      Count = Queue.size();
+      return;
    }
+
+   // Commands are run in order so once these have completed
+   // so has everything that was queued before them
+   CompletionHandle const Interactive = QueueCommand([] () { }, Client::Interactive);
+   QueueCommand([] () { })->Wait();
+   Interactive->Wait();
 }
 
 
 void Client::Connect(std::string const & hostname, uint16_t port, uint32_t timeout_ms)
 {
-   QueueCommand([this, hostname, port, timeout_ms] () { ConnectImpl(hostname, port, timeout_ms); });
+   QueueCommand([this, hostname, port, timeout_ms] ()
+   {
+      // Asking to connect starts afresh, even to the same server
+      CancelReconnect();
+      ConnectImpl(hostname, port, timeout_ms);
+   });
    //ConnectImpl(hostname, port, timeout_ms);
 }
 
@@ -268,11 +806,9 @@ void Client::ConnectImpl(std::string const & hostname, uint16_t port, uint32_t t
       connect_timeout *= 1000;
    }
 
-   // Connecting may take a long time as this is a single threaded application
-   // and the mpd connect is a blocking call, so be sure to update the screen
-   // first to let the user know that something is happening
-   currentState_ = "Connecting";
-   StateEvent();
+   // Cancel any connection attempt that is still in progress, the new host
+   // always takes priority over the old one
+   CancelConnect();
 
    hostname_   = connect_hostname;
    port_       = connect_port;
@@ -283,60 +819,463 @@ void Client::ConnectImpl(std::string const & hostname, uint16_t port, uint32_t t
    HostData.port     = port_;
    Main::Vimpc::CreateEvent(Event::ChangeHost, HostData);
 
-   //! \TODO make the connection async
    Debug("Client::Connecting to %s:%u - timeout %u", connect_hostname.c_str(), connect_port, connect_timeout);
-   connection_ = mpd_connection_new(connect_hostname.c_str(), connect_port, connect_timeout);
 
-   CheckError();
+   pending_ = new PendingConnection(connect_hostname, connect_port, connect_timeout, connect_password);
+   ++connectId_;
 
-   if (Connected() == true)
+   // The connection is established in small non-blocking steps that are each
+   // requeued on the command queue, so a slow or dead host does not stop
+   // other commands from being serviced and can be cancelled by a new connect
+   if (pending_->StartResolve() == false)
    {
-      fd_ = mpd_connection_get_fd(connection_);
-
-      Debug("Client::Connected.");
+      pending_->state_ = PendingConnection::Resolving;
+      currentState_    = "Resolving";
+   }
+   else
+   {
+      pending_->state_ = PendingConnection::Connecting;
+      currentState_    = "Connecting";
+   }
 
-      EventData Data;
-      Main::Vimpc::CreateEvent(Event::Connected, Data);
-      Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+   StateEvent();
+   ConnectStep(connectId_);
+}
 
-      GetVersion();
+void Client::ConnectStep(uint32_t connectId)
+{
+   if ((connectId != connectId_) || (pending_ == NULL))
+   {
+      // A newer connect has superseded this one
+      return;
+   }
 
-      if (connect_password != "")
-      {
-         Password(connect_password);
-      }
+   PendingConnection & Pending = *pending_;
 
-      elapsed_ = 0;
+   if (Pending.TimedOut() == true)
+   {
+      ConnectFailed("timed out");
+      return;
+   }
 
-      if (IsPasswordRequired() == false)
+   if (Pending.state_ == PendingConnection::Resolving)
+   {
+      if (Pending.Resolved() == false)
       {
-         Initialise();
+         // The resolver wakes the executor, which steps again from ResolveSteps
+         return;
       }
-      else
+      else if (Pending.addresses_.empty() == true)
       {
-         StateEvent();
-         EventData Data;
-         Main::Vimpc::CreateEvent(Event::RequirePassword, Data);
+         ConnectFailed("unable to resolve host");
+         return;
       }
+
+      Pending.state_ = PendingConnection::Connecting;
+      currentState_  = "Connecting";
+      StateEvent();
    }
-   else
+
+   if (Pending.state_ == PendingConnection::Connecting)
+   {
+      if ((Pending.fd_ == -1) && (Pending.ConnectNextAddress() == false))
+      {
+         Pending.ForgetAddresses();
+         ConnectFailed("connection refused");
+         return;
+      }
+
+      int const Result = Pending.WaitForConnect(ConnectStepMs);
+
+      if (Result < 0)
+      {
+         // Try the next address on the next step
+         Pending.CloseSocket();
+      }
+      else if (Result > 0)
+      {
+         Pending.state_ = PendingConnection::Welcome;
+      }
+   }
+   else if (Pending.state_ == PendingConnection::Welcome)
+   {
+      int const Result = Pending.ReadWelcome(ConnectStepMs);
+
+      if (Result < 0)
+      {
+         Pending.CloseSocket();
+         Pending.state_ = PendingConnection::Connecting;
+      }
+      else if (Result > 0)
+      {
+         ConnectComplete();
+         return;
+      }
+   }
+
+   QueueCommand([this, connectId] () { ConnectStep(connectId); });
+}
+
+void Client::ConnectComplete()
+{
+   std::string const ConnectPassword = pending_->password_;
+   uint32_t    const Timeout  = pending_->timeout_;
+
+   // Ownership of the socket is passed to libmpdclient here
+   struct mpd_async * async = mpd_async_new(pending_->fd_);
+   pending_->fd_ = -1;
+
+   if (async != NULL)
+   {
+      connection_ = mpd_connection_new_async(async, pending_->welcome_.c_str());
+   }
+
+   CancelConnect();
+
+   if ((connection_ != NULL) && (mpd_connection_get_error(connection_) != MPD_ERROR_SUCCESS))
+   {
+      Debug("Client::Connect failed %s", mpd_connection_get_error_message(connection_));
+      mpd_connection_free(connection_);
+      connection_ = NULL;
+   }
+
+   if (Connected() == true)
+   {
+      // Zero would make every read fail straight away, keep libmpdclient's default
+      if (Timeout != 0)
+      {
+         mpd_connection_set_timeout(connection_, Timeout);
+      }
+
+      fd_             = mpd_connection_get_fd(connection_);
+      connectTimeout_ = Timeout;
+      password_       = "";
+
+      Debug("Client::Connected.");
+
+      EventData Data;
+      Main::Vimpc::CreateEvent(Event::Connected, Data);
+      Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+
+      GetVersion();
+
+      if (ConnectPassword != "")
+      {
+         Password(ConnectPassword);
+      }
+
+      elapsed_ = 0;
+
+      if (IsPasswordRequired() == false)
+      {
+         Initialise();
+      }
+      else
+      {
+         StateEvent();
+         EventData Data;
+         Main::Vimpc::CreateEvent(Event::RequirePassword, Data);
+      }
+   }
+   else
+   {
+      ConnectFailed("invalid response");
+   }
+}
+
+void Client::ConnectFailed(std::string const & reason)
+{
+   Debug("Client::Connect failed, %s", reason.c_str());
+
+   CancelConnect();
+
+   currentState_ = "Disconnected";
+   StateEvent();
+
+   if (reconnectDelay_ > 0)
+   {
+      ScheduleReconnect();
+   }
+   else
    {
       Error(ErrorNumber::ClientNoConnection, "Failed to connect to server, please ensure it is running and type :connect <server> [port]");
    }
 }
 
+void Client::CancelConnect()
+{
+   if (pending_ != NULL)
+   {
+      delete pending_;
+      pending_ = NULL;
+   }
+}
+
+void Client::ScheduleReconnect()
+{
+   reconnectDelay_  = (reconnectDelay_ == 0) ? ReconnectMinMs : std::min(ReconnectMaxMs, reconnectDelay_ * 2);
+   timeToReconnect_ = reconnectDelay_;
+
+   Debug("Client::Reconnecting in %ld ms", reconnectDelay_);
+
+   currentState_ = "Reconnecting";
+   StateEvent();
+}
+
+void Client::CancelReconnect()
+{
+   reconnectDelay_  = 0;
+   timeToReconnect_ = -1;
+   resync_          = false;
+}
+
+bool Client::ServerStats(uint64_t & dbUpdate, time_t & started, uint32_t & songs)
+{
+   bool Result = false;
+
+   if (Connected() == true)
+   {
+      struct mpd_stats * stats = mpd_run_stats(connection_);
+
+      if (stats != NULL)
+      {
+         dbUpdate = mpd_stats_get_db_update_time(stats);
+         started  = time(NULL) - static_cast<time_t>(mpd_stats_get_uptime(stats));
+         songs    = mpd_stats_get_number_of_songs(stats);
+         Result   = true;
+         mpd_stats_free(stats);
+      }
+
+      ClearCommand();
+   }
+
+   return Result;
+}
+
+bool Client::Resync()
+{
+   uint64_t DBUpdate = 0;
+   time_t   Started  = 0;
+   uint32_t Songs    = 0;
+   int      Version  = -1;
+
+   // The status queued by Initialise has not run yet, so the queue version
+   // to compare against has to be fetched here
+   if (Connected() == true)
+   {
+      struct mpd_status * status = mpd_run_status(connection_);
+
+      if (status != NULL)
+      {
+         Version = static_cast<int>(mpd_status_get_queue_version(status));
+         mpd_status_free(status);
+      }
+
+      ClearCommand();
+   }
+
+   // The library and queue from before the connection dropped can only be
+   // kept if it is the same mpd and its database has not been updated since
+   if ((settings_.Get(Setting::ListAllMeta) == false) || (dbUpdate_ == 0) ||
+       (ServerStats(DBUpdate, Started, Songs) == false) || (DBUpdate != dbUpdate_) ||
+       (labs(static_cast<long>(Started - serverStarted_)) > ServerStartSlack) ||
+       (resyncVersion_ < 0) || (Version < resyncVersion_))
+   {
+      Debug("Client::Resync not possible, queue %d was %d, reloading everything", Version, resyncVersion_);
+      return false;
+   }
+
+   Debug("Client::Resync queue changes since %d to %d", resyncVersion_, Version);
+
+   if (Version != resyncVersion_)
+   {
+      oldVersion_  = resyncVersion_;
+      queueUpdate_ = true;
+   }
+
+   // Stored playlists are cheap to list and may have changed
+   UpdateStoredPlaylists();
+
+   EventData DatabaseEvent; DatabaseEvent.state = true;
+   Main::Vimpc::CreateEvent(Event::DatabaseEnabled, DatabaseEvent);
+
+   EventData Data;
+   Main::Vimpc::CreateEvent(Event::AllMetaDataReady, Data);
+   Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+   return true;
+}
+
 void Client::Initialise()
 {
    UpdateStatus();
    StateEvent();
 
-   GetAllMetaInformation();
+   if ((resync_ == false) || (Resync() == false))
+   {
+      GetAllMetaInformation();
+   }
+
+   resync_ = false;
    UpdateCurrentSong();
 
    if (Connected() == true)
    {
-      ready_   = true;
-      retried_ = false;
+      ready_          = true;
+      reconnectDelay_ = 0;
+
+      if ((settings_.Get(Setting::IdleConnection) == true) &&
+          (settings_.Get(Setting::Polling) == false))
+      {
+         OpenIdleConnection();
+      }
+   }
+}
+
+void Client::OpenIdleConnection()
+{
+   CloseIdleConnection();
+
+   Debug("Client::Opening idle connection to %s:%u", hostname_.c_str(), port_);
+
+   // The address is normally cached from the command connection, but the
+   // connect itself could still stall so it is done in steps, if it fails
+   // we just fall back to idling on the command connection
+   idlePending_ = new PendingConnection(hostname_, port_, connectTimeout_, password_);
+
+   idlePending_->state_ = (idlePending_->StartResolve() == true) ?
+      PendingConnection::Connecting : PendingConnection::Resolving;
+
+   IdleConnectStep(idleConnectId_);
+}
+
+void Client::IdleConnectStep(uint32_t connectId)
+{
+   if ((connectId != idleConnectId_) || (idlePending_ == NULL))
+   {
+      return;
+   }
+
+   PendingConnection & Pending = *idlePending_;
+   bool failed = false;
+
+   if (Pending.TimedOut() == true)
+   {
+      failed = true;
+   }
+   else if (Pending.state_ == PendingConnection::Resolving)
+   {
+      if (Pending.Resolved() == false)
+      {
+         // As for the command connection, ResolveSteps carries on from here
+         return;
+      }
+
+      failed         = Pending.addresses_.empty();
+      Pending.state_ = PendingConnection::Connecting;
+   }
+   else if (Pending.state_ == PendingConnection::Connecting)
+   {
+      if ((Pending.fd_ == -1) && (Pending.ConnectNextAddress() == false))
+      {
+         failed = true;
+      }
+      else
+      {
+         int const Result = Pending.WaitForConnect(ConnectStepMs);
+
+         if (Result < 0)
+         {
+            Pending.CloseSocket();
+         }
+         else if (Result > 0)
+         {
+            Pending.state_ = PendingConnection::Welcome;
+         }
+      }
+   }
+   else if (Pending.state_ == PendingConnection::Welcome)
+   {
+      int const Result = Pending.ReadWelcome(ConnectStepMs);
+
+      if (Result < 0)
+      {
+         Pending.CloseSocket();
+         Pending.state_ = PendingConnection::Connecting;
+      }
+      else if (Result > 0)
+      {
+         IdleConnectComplete();
+         return;
+      }
+   }
+
+   if (failed == true)
+   {
+      Debug("Client::Unable to open idle connection");
+      CloseIdleConnection();
+   }
+   else
+   {
+      QueueCommand([this, connectId] () { IdleConnectStep(connectId); });
+   }
+}
+
+void Client::IdleConnectComplete()
+{
+   std::string const IdlePassword = idlePending_->password_;
+   uint32_t    const Timeout      = idlePending_->timeout_;
+
+   // Ownership of the socket is passed to libmpdclient here
+   struct mpd_async * async = mpd_async_new(idlePending_->fd_);
+   idlePending_->fd_ = -1;
+
+   if (async != NULL)
+   {
+      idleConnection_ = mpd_connection_new_async(async, idlePending_->welcome_.c_str());
+   }
+
+   delete idlePending_;
+   idlePending_ = NULL;
+
+   if ((idleConnection_ != NULL) && (Timeout != 0))
+   {
+      mpd_connection_set_timeout(idleConnection_, Timeout);
+   }
+
+   if ((idleConnection_ != NULL) &&
+       (mpd_connection_get_error(idleConnection_) == MPD_ERROR_SUCCESS) &&
+       ((IdlePassword == "") || (mpd_run_password(idleConnection_, IdlePassword.c_str()) == true)) &&
+       (mpd_send_idle(idleConnection_) == true))
+   {
+      idleFd_ = mpd_connection_get_fd(idleConnection_);
+      Debug("Client::Idle connection established");
+
+      // Stop idling on the command connection now the idle connection does it
+      ExitIdleMode();
+   }
+   else
+   {
+      Debug("Client::Unable to open idle connection");
+      CloseIdleConnection();
+   }
+}
+
+void Client::CloseIdleConnection()
+{
+   // Stop any idle connection that is still being established
+   ++idleConnectId_;
+
+   if (idlePending_ != NULL)
+   {
+      delete idlePending_;
+      idlePending_ = NULL;
+   }
+
+   if (idleConnection_ != NULL)
+   {
+      mpd_connection_free(idleConnection_);
+      idleConnection_ = NULL;
+      idleFd_         = -1;
    }
 }
 
@@ -345,6 +1284,11 @@ void Client::Disconnect()
 {
    QueueCommand([this] ()
    {
+      // Stop any connection that is still being established
+      ++connectId_;
+      CancelConnect();
+      CancelReconnect();
+
       if (Connected() == true)
       {
          Debug("Client::Disconnect");
@@ -367,6 +1311,8 @@ void Client::Password(std::string const & password)
 {
       ClearCommand();
 
+      password_ = password;
+
       if (Connected() == true)
       {
          Debug("Client::Sending password");
@@ -413,7 +1359,7 @@ void Client::Play(uint32_t const playId)
       {
          ErrorString(ErrorNumber::ClientNoConnection);
       }
-   });
+   }, Interactive);
 }
 
 
@@ -459,7 +1405,7 @@ void Client::Pause()
       {
          ErrorString(ErrorNumber::ClientNoConnection);
       }
-   });
+   }, Interactive);
 }
 
 void Client::Stop()
@@ -482,7 +1428,7 @@ void Client::Stop()
       {
          ErrorString(ErrorNumber::ClientNoConnection);
       }
-   });
+   }, Interactive);
 }
 
 void Client::Next()
@@ -502,7 +1448,7 @@ void Client::Next()
       {
          ErrorString(ErrorNumber::ClientNoConnection);
       }
-   });
+   }, Interactive);
 }
 
 void Client::Previous()
@@ -522,7 +1468,7 @@ void Client::Previous()
       {
          ErrorString(ErrorNumber::ClientNoConnection);
       }
-   });
+   }, Interactive);
 }
 
 void Client::Seek(int32_t Offset)
@@ -543,7 +1489,7 @@ void Client::Seek(int32_t Offset)
       {
          ErrorString(ErrorNumber::ClientNoConnection);
       }
-   });
+   }, Interactive);
 }
 
 void Client::SeekTo(uint32_t Time)
@@ -564,7 +1510,7 @@ void Client::SeekTo(uint32_t Time)
       {
          ErrorString(ErrorNumber::ClientNoConnection);
       }
-   });
+   }, Interactive);
 }
 
 void Client::SeekToPercent(double Percent)
@@ -578,7 +1524,7 @@ void Client::SeekToPercent(double Percent)
          uint32_t const duration = mpd_song_get_duration(currentSong_);
          SeekTo(static_cast<uint32_t>(Percent * duration));
       }
-   });
+   }, Interactive);
 }
 
 
@@ -739,7 +1685,7 @@ void Client::SetVolume(uint32_t volume)
       {
          ErrorString(ErrorNumber::ClientNoConnection);
       }
-   });
+   }, Interactive);
 }
 
 void Client::SetMute(bool mute)
@@ -759,7 +1705,7 @@ void Client::SetMute(bool mute)
       mute_ = mute;
       EventData Data; Data.state = mute_;
       Main::Vimpc::CreateEvent(Event::Mute, Data);
-   });
+   }, Interactive);
 }
 
 void Client::DeltaVolume(int32_t Delta)
@@ -790,7 +1736,7 @@ void Client::DeltaVolume(int32_t Delta)
             Main::Vimpc::CreateEvent(Event::Volume, Data);
          }
       }
-   });
+   }, Interactive);
 }
 
 void Client::ToggleRandom()
@@ -917,7 +1863,7 @@ void Client::Shuffle()
 
 void Client::Move(uint32_t position1, uint32_t position2)
 {
-   QueueCommand([this, position1, position2] ()
+   QueueBatchableCommand([this, position1, position2] ()
    {
       ClearCommand();
 
@@ -935,7 +1881,7 @@ void Client::Move(uint32_t position1, uint32_t position2)
 
 void Client::Swap(uint32_t position1, uint32_t position2)
 {
-   QueueCommand([this, position1, position2] ()
+   QueueBatchableCommand([this, position1, position2] ()
    {
       ClearCommand();
 
@@ -1097,7 +2043,7 @@ void Client::AddToNamedPlaylist(std::string const & name, Mpc::Song * song)
 {
    std::string URI = song->URI();
 
-   QueueCommand([this, name, URI] ()
+   QueueBatchableCommand([this, name, URI] ()
    {
       ClearCommand();
 
@@ -1118,8 +2064,6 @@ void Client::PlaylistContents(std::string const & name)
 {
    QueueCommand([this, name] ()
    {
-      std::string const SongFormat = settings_.Get(Setting::SongFormat);
-
       ClearCommand();
 
       if (Connected() == true)
@@ -1131,6 +2075,7 @@ void Client::PlaylistContents(std::string const & name)
          mpd_song * nextSong = mpd_recv_song(connection_);
 
          std::vector<std::string> URIs;
+         std::vector<Mpc::Song *> songs;
 
          if (nextSong == NULL)
          {
@@ -1147,10 +2092,7 @@ void Client::PlaylistContents(std::string const & name)
                    if (song == NULL)
                    {
                        song = CreateSong(nextSong);
-                       // Pre cache the print of the song
-                       (void) song->FormatString(SongFormat);
-                       EventData Data; Data.song = song;
-                       Main::Vimpc::CreateEvent(Event::DatabaseSong, Data);
+                       songs.push_back(song);
                    }
                }
 
@@ -1158,8 +2100,10 @@ void Client::PlaylistContents(std::string const & name)
                mpd_song_free(nextSong);
             }
 
-            EventData Data; Data.name = name; Data.uris = URIs;
-            Main::Vimpc::CreateEvent(Event::PlaylistContents, Data);
+            DatabaseSongEvents(songs);
+
+            EventData Data; Data.name = name; Data.Payload().uris = URIs;
+            Main::Vimpc::CreateEvent(Event::PlaylistContents, std::move(Data));
          }
       }
    });
@@ -1189,8 +2133,8 @@ void Client::PlaylistContentsForRemove(std::string const & name)
                mpd_song_free(nextSong);
             }
 
-            EventData Data; Data.name = name; Data.uris = URIs;
-            Main::Vimpc::CreateEvent(Event::PlaylistContentsForRemove, Data);
+            EventData Data; Data.name = name; Data.Payload().uris = URIs;
+            Main::Vimpc::CreateEvent(Event::PlaylistContentsForRemove, std::move(Data));
          }
       }
    });
@@ -1272,66 +2216,81 @@ void Client::Add(Mpc::Song * song)
 void Client::Add(std::vector<Mpc::Song *> songs)
 {
    std::vector<std::string> URIs;
+   URIs.reserve(songs.size());
 
    for (auto song : songs)
    {
       URIs.push_back(song->URI());
    }
 
-   QueueCommand([this, URIs] ()
+   QueueCommand([this, URIs] () { AddURIs(URIs); });
+}
+
+void Client::AddURIs(std::vector<std::string> const & URIs)
+{
+   for (size_t Start = 0; Start < URIs.size(); Start += AddChunkSize)
    {
+      // Let anything interactive that has been queued go first
+      if (Start > 0)
+      {
+         RunInteractiveCommands();
+      }
+
       ClearCommand();
 
-      if (Connected() == true)
+      if (Connected() == false)
       {
-         if (mpd_command_list_begin(connection_, false) == true)
-         {
-            listMode_ = true;
+         ErrorString(ErrorNumber::ClientNoConnection);
+         return;
+      }
 
-            Debug("Client::List add started");
+      size_t const End = std::min(URIs.size(), Start + AddChunkSize);
 
-            for (auto URI : URIs)
-            {
-               mpd_send_add(connection_, URI.c_str());
-            }
+      if (mpd_command_list_begin(connection_, false) == true)
+      {
+         listMode_ = true;
 
-            if (mpd_command_list_end(connection_) == true)
-            {
-               Debug("Client::List add success");
-               listMode_ = false;
+         Debug("Client::List add started %u - %u", static_cast<uint32_t>(Start), static_cast<uint32_t>(End));
 
-               for (auto URI : URIs)
-               {
-                  EventData Data; Data.uri = URI; Data.pos1 = -1;
-                  Main::Vimpc::CreateEvent(Event::PlaylistAdd, Data);
-               }
+         for (size_t i = Start; i < End; ++i)
+         {
+            mpd_send_add(connection_, URIs[i].c_str());
+         }
 
-               EventData Data;
-               Main::Vimpc::CreateEvent(Event::CommandListSend, Data);
-               Main::Vimpc::CreateEvent(Event::Repaint,   Data);
-            }
-            else
+         if (mpd_command_list_end(connection_) == true)
+         {
+            Debug("Client::List add success");
+            listMode_ = false;
+
+            for (size_t i = Start; i < End; ++i)
             {
-               CheckError();
+               EventData Data; Data.uri = URIs[i]; Data.pos1 = -1;
+               Main::Vimpc::CreateEvent(Event::PlaylistAdd, Data);
             }
-         }
-         else
+
+            EventData Data;
+            Main::Vimpc::CreateEvent(Event::CommandListSend, Data);
+            Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+         }
+         else
          {
             CheckError();
+            return;
          }
       }
       else
       {
-         ErrorString(ErrorNumber::ClientNoConnection);
+         CheckError();
+         return;
       }
-   });
+   }
 }
 
 void Client::Add(Mpc::Song & song)
 {
    std::string URI = song.URI();
 
-   QueueCommand([this, URI] ()
+   QueueBatchableCommand([this, URI] ()
    {
       ClearCommand();
 
@@ -1354,7 +2313,7 @@ void Client::Add(Mpc::Song & song, uint32_t position)
 {
    std::string URI = song.URI();
 
-   QueueCommand([this, URI, position] ()
+   QueueBatchableCommand([this, URI, position] ()
    {
       ClearCommand();
 
@@ -1400,7 +2359,7 @@ void Client::AddAllSongs()
 
 void Client::Add(std::string const & URI)
 {
-   QueueCommand([this, URI] ()
+   QueueBatchableCommand([this, URI] ()
    {
       ClearCommand();
 
@@ -1419,7 +2378,7 @@ void Client::Add(std::string const & URI)
 
 void Client::Delete(uint32_t position)
 {
-   QueueCommand([this, position] ()
+   QueueBatchableCommand([this, position] ()
    {
       ClearCommand();
 
@@ -1448,7 +2407,7 @@ void Client::Delete(uint32_t position)
 
 void Client::Delete(uint32_t position1, uint32_t position2)
 {
-   QueueCommand([this, position1, position2] ()
+   QueueBatchableCommand([this, position1, position2] ()
    {
       // There might be an add in the queue, so we can't use the totalNumberOfSongs_ to determine
       // whether or not to do a delete
@@ -1530,8 +2489,7 @@ void Client::SearchAny(std::string const & search, bool exact)
       if (Connected() == true)
       {
          Debug("Client::Search any %s - exact %d", search.c_str(), static_cast<int32_t>(exact));
-         mpd_search_db_songs(connection_, exact);
-         mpd_search_add_any_tag_constraint(connection_, MPD_OPERATOR_DEFAULT, search.c_str());
+         Search(MPD_TAG_UNKNOWN, search, exact);
       }
    });
 }
@@ -1545,8 +2503,7 @@ void Client::SearchArtist(std::string const & search, bool exact)
       if (Connected() == true)
       {
          Debug("Client::Search artist %s - exact %d", search.c_str(), static_cast<int32_t>(exact));
-         mpd_search_db_songs(connection_, exact);
-         mpd_search_add_tag_constraint(connection_, MPD_OPERATOR_DEFAULT, MPD_TAG_ARTIST, search.c_str());
+         Search(MPD_TAG_ARTIST, search, exact);
       }
    });
 }
@@ -1560,8 +2517,7 @@ void Client::SearchGenre(std::string const & search, bool exact)
       if (Connected() == true)
       {
          Debug("Client::Search genre %s - exact %d", search.c_str(), static_cast<int32_t>(exact));
-         mpd_search_db_songs(connection_, exact);
-         mpd_search_add_tag_constraint(connection_, MPD_OPERATOR_DEFAULT, MPD_TAG_GENRE, search.c_str());
+         Search(MPD_TAG_GENRE, search, exact);
       }
    });
 }
@@ -1576,8 +2532,7 @@ void Client::SearchAlbum(std::string const & search, bool exact)
       if (Connected() == true)
       {
          Debug("Client::Search album %s - exact %d", search.c_str(), static_cast<int32_t>(exact));
-         mpd_search_db_songs(connection_, exact);
-         mpd_search_add_tag_constraint(connection_, MPD_OPERATOR_DEFAULT, MPD_TAG_ALBUM, search.c_str());
+         Search(MPD_TAG_ALBUM, search, exact);
       }
    });
 }
@@ -1591,8 +2546,26 @@ void Client::SearchSong(std::string const & search, bool exact)
       if (Connected() == true)
       {
          Debug("Client::Search title %s - exact %d", search.c_str(), static_cast<int32_t>(exact));
-         mpd_search_db_songs(connection_, exact);
-         mpd_search_add_tag_constraint(connection_, MPD_OPERATOR_DEFAULT, MPD_TAG_TITLE, search.c_str());
+         Search(MPD_TAG_TITLE, search, exact);
+      }
+   });
+}
+
+void Client::SearchExpression(std::string const & expression)
+{
+   QueueCommand([this, expression] ()
+   {
+      ClearCommand();
+
+      if (Connected() == true)
+      {
+         Debug("Client::Search expression %s", expression.c_str());
+         searchTag_        = MPD_TAG_UNKNOWN;
+         searchTerm_       = "";
+         searchExpression_ = expression;
+         searchExact_      = false;
+
+         BeginSearch();
       }
    });
 }
@@ -1604,8 +2577,6 @@ void Client::AddAllSearchResults()
    {
       if (Connected())
       {
-         Mpc::Song Song;
-
          // Start the search
          Debug("Client::Add all search results");
          mpd_search_commit(connection_);
@@ -1619,12 +2590,15 @@ void Client::AddAllSearchResults()
          }
          else
          {
+            std::vector<std::string> URIs;
+
             for (; nextSong != NULL; nextSong = mpd_recv_song(connection_))
             {
-               Song.SetURI(mpd_song_get_uri(nextSong));
-               Add(Song);
+               URIs.push_back(mpd_song_get_uri(nextSong));
                mpd_song_free(nextSong);
             }
+
+            AddURIs(URIs);
          }
       }
    });
@@ -1634,51 +2608,138 @@ void Client::SearchResults(std::string const & name)
 {
    QueueCommand([this, name] ()
    {
-      std::string const SongFormat = settings_.Get(Setting::SongFormat);
-
       if (Connected())
       {
-         Mpc::Song Song;
-
-         // Start the search
+         // The search was started by one of the Search functions
          Debug("Client::Search results via events");
-         mpd_search_commit(connection_);
 
-         // Recv the songs and do some callbacks
-         mpd_song * nextSong = mpd_recv_song(connection_);
+         searchName_   = name;
+         searchOffset_ = 0;
+         ++searchId_;
 
-         if (nextSong == NULL)
+         SearchPage((SearchPaged() == true) ? SearchPageSize : 0);
+      }
+   });
+}
+
+void Client::SearchMore(uint32_t id, uint32_t offset)
+{
+   // Screen updates ask for the next page until it arrives, only one is requested
+   if (searchPending_ == false)
+   {
+      searchPending_ = true;
+
+      QueueCommand([this, id, offset] ()
+      {
+         if ((Connected() == true) && (id == searchId_) && (offset == searchOffset_))
          {
-            ErrorString(ErrorNumber::FindNoResults);
+            Debug("Client::Search results from %u", offset);
+            BeginSearch();
+            SearchPage(SearchPageSize);
          }
-         else
-         {
-            EventData Data; Data.name = name;
 
-            for (; nextSong != NULL; nextSong = mpd_recv_song(connection_))
-            {
-               if ((settings_.Get(Setting::ListAllMeta) == false))
-               {
-                   Mpc::Song * song = Main::Library().Song(mpd_song_get_uri(nextSong));
+         searchPending_ = false;
+      });
+   }
+}
 
-                   if (song == NULL)
-                   {
-                       song = CreateSong(nextSong);
-                       // Pre cache the print of the song
-                       (void) song->FormatString(SongFormat);
-                       EventData Data; Data.song = song;
-                       Main::Vimpc::CreateEvent(Event::DatabaseSong, Data);
-                   }
-               }
 
-               Data.uris.push_back(mpd_song_get_uri(nextSong));
-               mpd_song_free(nextSong);
-            }
+void Client::Search(mpd_tag_type tag, std::string const & search, bool exact)
+{
+   searchTag_        = tag;
+   searchTerm_       = search;
+   searchExpression_ = "";
+   searchExact_      = exact;
 
-            Main::Vimpc::CreateEvent(Event::SearchResults, Data);
-         }
+   BeginSearch();
+}
+
+void Client::BeginSearch()
+{
+   mpd_search_db_songs(connection_, searchExact_);
+
+#if LIBMPDCLIENT_CHECK_VERSION(2,15,0)
+   if (searchExpression_ != "")
+   {
+      mpd_search_add_expression(connection_, searchExpression_.c_str());
+   }
+   else
+#endif
+   if (searchTag_ == MPD_TAG_UNKNOWN)
+   {
+      mpd_search_add_any_tag_constraint(connection_, MPD_OPERATOR_DEFAULT, searchTerm_.c_str());
+   }
+   else
+   {
+      mpd_search_add_tag_constraint(connection_, MPD_OPERATOR_DEFAULT, searchTag_, searchTerm_.c_str());
+   }
+}
+
+bool Client::SearchPaged() const
+{
+   // The window argument to find and search was added in mpd 0.20, but
+   // pages are only consistent with each other if mpd sorts the results,
+   // which it can do from 0.21. Older servers send everything at once.
+#if LIBMPDCLIENT_CHECK_VERSION(2,11,0)
+   return ((versionMajor_ > 0) || (versionMinor_ >= 21));
+#else
+   return false;
+#endif
+}
+
+void Client::SearchPage(uint32_t count)
+{
+#if LIBMPDCLIENT_CHECK_VERSION(2,11,0)
+   if (count > 0)
+   {
+      mpd_search_add_sort_tag(connection_, MPD_TAG_ARTIST, false);
+      mpd_search_add_window(connection_, searchOffset_, searchOffset_ + count);
+   }
+#endif
+
+   mpd_search_commit(connection_);
+
+   // Recv the songs and do some callbacks
+   EventData Data;
+   std::vector<Mpc::Song *> songs;
+
+   for (mpd_song * nextSong = mpd_recv_song(connection_); nextSong != NULL; nextSong = mpd_recv_song(connection_))
+   {
+      if ((settings_.Get(Setting::ListAllMeta) == false))
+      {
+          Mpc::Song * song = Main::Library().Song(mpd_song_get_uri(nextSong));
+
+          if (song == NULL)
+          {
+              song = CreateSong(nextSong);
+              songs.push_back(song);
+          }
       }
-   });
+
+      Data.Payload().uris.push_back(mpd_song_get_uri(nextSong));
+      mpd_song_free(nextSong);
+   }
+
+   CheckError();
+
+   if ((Data.Payload().uris.empty() == true) && (searchOffset_ == 0))
+   {
+      ErrorString(ErrorNumber::FindNoResults);
+   }
+   else
+   {
+      // The window that shows the first page is given the rest by id
+      Data.name  = searchName_;
+      Data.id    = searchId_;
+      Data.pos1  = searchOffset_;
+      Data.count = searchOffset_ + Data.Payload().uris.size();
+      Data.state = (count > 0) && (Data.Payload().uris.size() == count);
+
+      searchOffset_ = Data.count;
+
+      DatabaseSongEvents(songs);
+      Main::Vimpc::CreateEvent(Event::SearchResults, std::move(Data));
+   }
 }
 
 
@@ -1711,52 +2772,12 @@ void Client::StateEvent()
 
 void Client::Rescan(std::string const & Path)
 {
-   QueueCommand([this, Path] ()
-   {
-      ClearCommand();
-
-      if (Connected() == true)
-      {
-         Debug("Client::Rescan %s", (Path != "") ? Path.c_str() : "all");
-
-         if (mpd_run_rescan(connection_, (Path != "") ? Path.c_str() : NULL) == true)
-         {
-            updating_ = true;
-
-            EventData Data;
-            Main::Vimpc::CreateEvent(Event::Update, Data);
-         }
-      }
-      else
-      {
-         ErrorString(ErrorNumber::ClientNoConnection);
-      }
-   });
+   QueueCommand([this, Path] () { ScheduleUpdate(Path, true); });
 }
 
 void Client::Update(std::string const & Path)
 {
-   QueueCommand([this, Path] ()
-   {
-      ClearCommand();
-
-      if (Connected() == true)
-      {
-         Debug("Client::Update %s", (Path != "") ? Path.c_str() : "all");
-
-         if (mpd_run_update(connection_, (Path != "") ? Path.c_str() : NULL) == true)
-         {
-            updating_ = true;
-
-            EventData Data;
-            Main::Vimpc::CreateEvent(Event::Update, Data);
-         }
-      }
-      else
-      {
-         ErrorString(ErrorNumber::ClientNoConnection);
-      }
-   });
+   QueueCommand([this, Path] () { ScheduleUpdate(Path, false); });
 }
 
 void Client::IncrementTime(long time)
@@ -1765,7 +2786,8 @@ void Client::IncrementTime(long time)
 
    if (time >= 0)
    {
-      timeSinceUpdate_ += time;
+      timeSinceUpdate_  += time;
+      timeSinceCommand_ += time;
 
       if (state_ == MPD_STATE_PLAY)
       {
@@ -1778,10 +2800,32 @@ void Client::IncrementTime(long time)
          }
       }
 
-      if ((poll == true) && (timeSinceUpdate_ > 900))
+      if ((poll == true) && (timeSinceUpdate_ > PollIntervalMs))
       {
          UpdateStatus();
       }
+
+      if (timeToUpdate_ >= 0)
+      {
+         timeToUpdate_ = std::max(0L, timeToUpdate_ - time);
+
+         if (timeToUpdate_ == 0)
+         {
+            timeToUpdate_ = -1;
+            QueueCommand([this] () { SendUpdates(); });
+         }
+      }
+
+      if (timeToReconnect_ >= 0)
+      {
+         timeToReconnect_ = std::max(0L, timeToReconnect_ - time);
+
+         if (timeToReconnect_ == 0)
+         {
+            timeToReconnect_ = -1;
+            ConnectImpl(hostname_, port_, connectTimeout_);
+         }
+      }
    }
    else
    {
@@ -1792,6 +2836,7 @@ void Client::IncrementTime(long time)
 void Client::IdleMode()
 {
    if ((Connected() == true) &&
+       (idleConnection_ == NULL) &&
        (idleMode_ == false) &&
        (ready_ == true) &&
        (settings_.Get(Setting::Polling) == false))
@@ -1819,9 +2864,11 @@ void Client::ExitIdleMode()
    {
       mpd_send_noidle(connection_);
 
-      if (mpd_recv_idle(connection_, false) != 0)
+      int const Mask = mpd_recv_idle(connection_, false);
+
+      if (Mask != 0)
       {
-         UpdateStatus();
+         IdleEvents(Mask);
       }
 
       Debug("Client::Cancelled idle mode");
@@ -1834,6 +2881,46 @@ void Client::ExitIdleMode()
    }
 }
 
+void Client::CheckForIdleEvents()
+{
+   if ((idleConnection_ != NULL) && (idleFd_ != -1))
+   {
+      pollfd fds;
+
+      fds.fd      = idleFd_;
+      fds.events  = POLLIN;
+      fds.revents = 0;
+
+      if (poll(&fds, 1, 0) > 0)
+      {
+         int const Mask = mpd_recv_idle(idleConnection_, false);
+
+         if (Mask != 0)
+         {
+            Debug("Client::Event occurred on idle connection");
+            IdleEvents(Mask);
+         }
+
+         if ((mpd_connection_get_error(idleConnection_) != MPD_ERROR_SUCCESS) ||
+             (mpd_send_idle(idleConnection_) == false))
+         {
+            Debug("Client::Lost idle connection");
+            CloseIdleConnection();
+         }
+      }
+   }
+
+   // Without any traffic on the command connection mpd would eventually
+   // time it out, so keep it alive whilst only the idle connection is used
+   if ((Connected() == true) && (idleConnection_ != NULL) && (timeSinceCommand_ >= KeepAliveMs))
+   {
+      Debug("Client::Keep alive");
+      timeSinceCommand_ = 0;
+      mpd_send_command(connection_, "ping", NULL);
+      ClearCommand();
+   }
+}
+
 void Client::CheckForEvents()
 {
    if ((idleMode_ == true) && (Connected() == true) && (fd_ != -1))
@@ -1850,10 +2937,12 @@ void Client::CheckForEvents()
          EventData Data;
          Main::Vimpc::CreateEvent(Event::StopIdleMode, Data);
 
-         if (mpd_recv_idle(connection_, false) != 0)
+         int const Mask = mpd_recv_idle(connection_, false);
+
+         if (Mask != 0)
          {
-            UpdateStatus();
             Debug("Client::Event occurred");
+            IdleEvents(Mask);
          }
 
          Debug("Client::Left idle mode");
@@ -1863,349 +2952,1615 @@ void Client::CheckForEvents()
    }
 }
 
-void Client::UpdateCurrentSong()
+void Client::SyncDatabase()
 {
-   ClearCommand();
+   // If we know what was updated only that part of the database
+   // needs to be listed again, otherwise get everything
+   bool Incremental = (settings_.Get(Setting::ListAllMeta) == true);
 
-   if ((Connected() == true))
+   if ((Incremental == true) && (updatePaths_.empty() == true))
    {
-      if (listMode_ == false)
-      {
-         if (currentSong_ != NULL)
-         {
-            mpd_song_free(currentSong_);
-            currentSong_ = NULL;
-            currentSongId_ = -1;
-            currentSongURI_ = "";
-         }
-
-         Debug("Client::Send get current song");
-         currentSong_ = mpd_run_current_song(connection_);
-         CheckError();
+      Incremental = ModifiedPaths(updatePaths_);
+   }
 
-         if (currentSong_ != NULL)
-         {
-            currentSongId_  = mpd_song_get_pos(currentSong_);
-            currentSongURI_ = mpd_song_get_uri(currentSong_);
+   if ((Incremental == true) &&
+       (std::find(updatePaths_.begin(), updatePaths_.end(), "") == updatePaths_.end()))
+   {
+      GetUpdatedMetaInformation();
 
-            Debug("Client::Get current song %d:%s", currentSongId_, currentSongURI_.c_str());
-         }
+      // The library is now the same as the updated database
+      if ((dbUpdate_ != 0) && (ServerStats(dbUpdate_, serverStarted_, dbSongs_) == false))
+      {
+         dbUpdate_ = 0;
       }
    }
    else
    {
-      currentSongId_ = -1;
-      currentSongURI_ = "";
+      GetAllMetaInformation();
    }
 
-   EventData IdData; IdData.id = currentSongId_;
-   Main::Vimpc::CreateEvent(Event::CurrentSongId, IdData);
+   updatePaths_.clear();
+   UpdateCurrentSong();
 
-   if (autoscroll_ == true)
+   EventData Data;
+   Main::Vimpc::CreateEvent(Event::UpdateComplete, Data);
+   Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+}
+
+void Client::ScheduleUpdate(std::string const & Path, bool rescan)
+{
+   if (Connected() == true)
    {
-      Main::Vimpc::CreateEvent(Event::Autoscroll, IdData);
-      autoscroll_ = false;
-   }
+      Debug("Client::Schedule %s of %s", (rescan == true) ? "rescan" : "update", (Path != "") ? Path.c_str() : "all");
 
-   if (currentSong_ != NULL)
+      pendingUpdates_.push_back(Path);
+      pendingRescan_ = (pendingRescan_ || rescan);
+      timeToUpdate_  = UpdateDelayMs;
+   }
+   else
    {
-      EventData SongData; SongData.currentSong = mpd_song_dup(currentSong_);
-      Main::Vimpc::CreateEvent(Event::CurrentSong, SongData);
+      ErrorString(ErrorNumber::ClientNoConnection);
    }
 }
 
-void Client::ClientQueueExecutor(Mpc::Client * client)
+void Client::SendUpdates()
 {
-   struct timeval start, end;
-   gettimeofday(&start, NULL);
+   std::vector<std::string> const Paths = UpdateRoots(pendingUpdates_, UpdateMaxPaths);
+   bool const Rescan = pendingRescan_;
 
-   while (Running == true)
+   pendingUpdates_.clear();
+   pendingRescan_ = false;
+
+   ClearCommand();
+
+   if ((Connected() == true) && (Paths.empty() == false))
    {
-      gettimeofday(&end,   NULL);
-      long const seconds  = end.tv_sec  - start.tv_sec;
-      long const useconds = end.tv_usec - start.tv_usec;
-      long const mtime    = (seconds * 1000 + (useconds/1000.0)) + 0.5;
-      IncrementTime(mtime);
-      gettimeofday(&start, NULL);
+      Debug("Client::%s %u paths", (Rescan == true) ? "Rescan" : "Update", static_cast<uint32_t>(Paths.size()));
 
+      unsigned job = 0;
+
+      for (size_t Start = 0; ((Start < Paths.size()) && (Connected() == true)); Start += UpdateMaxPaths)
       {
-         UniqueLock<Mutex> Lock(QueueMutex);
+         size_t const End = std::min(Paths.size(), Start + UpdateMaxPaths);
+
+         ClearCommand();
 
-         if ((Queue.empty() == false) ||
-             (ConditionWait(Condition, Lock, 250) != false))
+         if (mpd_command_list_begin(connection_, true) == true)
          {
-            if (Queue.empty() == false)
+            for (size_t i = Start; i < End; ++i)
             {
-               FUNCTION<void()> function = Queue.front();
-               Queue.pop_front();
-               Lock.unlock();
+               char const * const Uri = (Paths[i] != "") ? Paths[i].c_str() : NULL;
+
+               if (Rescan == true)
+               {
+                  mpd_send_rescan(connection_, Uri);
+               }
+               else
+               {
+                  mpd_send_update(connection_, Uri);
+               }
+            }
 
-               ExitIdleMode();
-               function();
-               continue;
+            if (mpd_command_list_end(connection_) == true)
+            {
+               for (size_t i = Start; i < End; ++i)
+               {
+                  job = std::max(job, mpd_recv_update_id(connection_));
+                  mpd_response_next(connection_);
+               }
             }
          }
+
+         if (CheckError() == true)
+         {
+            break;
+         }
       }
 
+      if (job != 0)
       {
-         UniqueLock<Mutex> Lock(QueueMutex);
+         updating_  = true;
+         updateJob_ = job;
+         updatePaths_.insert(updatePaths_.end(), Paths.begin(), Paths.end());
 
-         if ((Queue.empty() == true) && (listMode_ == false))
-         {
-            if (queueUpdate_ == true)
-            {
-               Lock.unlock();
-               QueueMetaChanges();
-            }
-            else if (idleMode_ == false)
-            {
-               Lock.unlock();
-               IdleMode();
-            }
-            else if (idleMode_ == true)
-            {
-               Lock.unlock();
-               CheckForEvents();
-            }
-         }
+         EventData Data;
+         Main::Vimpc::CreateEvent(Event::Update, Data);
       }
    }
 }
 
-
-void Client::ClearCommand()
+void Client::IdleEvents(int mask)
 {
-	error_ = false;
+   Debug("Client::Idle events %x", mask);
 
-   if ((listMode_ == false) && (idleMode_ == false) && (Connected() == true))
+   // A status update looks at everything, so there is no need
+   // for anything more specific alongside it
+   if ((mask & (MPD_IDLE_PLAYER | MPD_IDLE_UPDATE)) != 0)
    {
-      Debug("Client::Finish the response");
-      mpd_response_finish(connection_);
-      CheckError();
+      UpdateStatus();
+   }
+   else
+   {
+      if ((mask & MPD_IDLE_MIXER) != 0)
+      {
+         UpdateMixer();
+      }
+
+      if ((mask & MPD_IDLE_OPTIONS) != 0)
+      {
+         UpdateOptions();
+      }
+
+      if ((mask & MPD_IDLE_QUEUE) != 0)
+      {
+         UpdateQueue();
+      }
+
+      if ((mask & MPD_IDLE_DATABASE) != 0)
+      {
+         UpdateDatabase();
+      }
+   }
+
+   if ((mask & MPD_IDLE_STORED_PLAYLIST) != 0)
+   {
+      UpdateStoredPlaylists();
+   }
+
+   if ((mask & MPD_IDLE_OUTPUT) != 0)
+   {
+      UpdateOutputs();
+   }
+}
+
+void Client::UpdateMixer()
+{
+   QueueCommand([this] ()
+   {
+      ClearCommand();
+
+      if ((Connected() == true) && (listMode_ == false))
+      {
+         Debug("Client::Get mixer status");
+         struct mpd_status * status = mpd_run_status(connection_);
+         CheckError();
+
+         if (status != NULL)
+         {
+            MixerStatus(status);
+            mpd_status_free(status);
+         }
+      }
+   });
+}
+
+void Client::UpdateOptions()
+{
+   QueueCommand([this] ()
+   {
+      ClearCommand();
+
+      if ((Connected() == true) && (listMode_ == false))
+      {
+         Debug("Client::Get options status");
+         struct mpd_status * status = mpd_run_status(connection_);
+         CheckError();
+
+         if (status != NULL)
+         {
+            OptionsStatus(status);
+            mpd_status_free(status);
+         }
+      }
+   });
+}
+
+void Client::UpdateQueue()
+{
+   QueueCommand([this] ()
+   {
+      // The changes are requested once nothing else is queued
+      if ((queueVersion_ > -1) && (queueUpdate_ == false))
+      {
+         oldVersion_  = queueVersion_;
+         queueUpdate_ = true;
+      }
+   });
+}
+
+void Client::UpdateDatabase()
+{
+   QueueCommand([this] ()
+   {
+      // Whilst an update is running the status update that
+      // sees it finish will list the changes
+      if ((Connected() == true) && (updating_ == false))
+      {
+         uint64_t DBUpdate = 0;
+         time_t   Started  = 0;
+         uint32_t Songs    = 0;
+
+         // The update event may have arrived first, in which case its sync has
+         // already listed the change that this event is about
+         if ((dbUpdate_ != 0) && (updatePaths_.empty() == true) &&
+             (ServerStats(DBUpdate, Started, Songs) == true) && (DBUpdate == dbUpdate_))
+         {
+            Debug("Client::Database already in sync");
+            return;
+         }
+
+         SyncDatabase();
+      }
+   });
+}
+
+void Client::UpdateStoredPlaylists()
+{
+#if LIBMPDCLIENT_CHECK_VERSION(2,5,0)
+   QueueCommand([this] ()
+   {
+      ClearCommand();
+
+      if ((Connected() == true) && (listMode_ == false))
+      {
+         Debug("Client::Request playlists");
+
+         if (mpd_send_list_playlists(connection_))
+         {
+            EventData Data;
+            mpd_playlist * nextPlaylist = mpd_recv_playlist(connection_);
+
+            for(; nextPlaylist != NULL; nextPlaylist = mpd_recv_playlist(connection_))
+            {
+               Data.Payload().uris.push_back(mpd_playlist_get_path(nextPlaylist));
+               mpd_playlist_free(nextPlaylist);
+            }
+
+            Main::Vimpc::CreateEvent(Event::StoredPlaylists, std::move(Data));
+            Main::Vimpc::CreateEvent(Event::Repaint, EventData());
+         }
+
+         CheckError();
+      }
+   });
+#endif
+}
+
+void Client::UpdateOutputs()
+{
+   QueueCommand([this] ()
+   {
+      ClearCommand();
+
+      if ((Connected() == true) && (listMode_ == false))
+      {
+         Debug("Client::Get output states");
+         mpd_send_outputs(connection_);
+
+         mpd_output * next = mpd_recv_output(connection_);
+
+         for (; next != NULL; next = mpd_recv_output(connection_))
+         {
+            EventData Data; Data.id = mpd_output_get_id(next);
+            Main::Vimpc::CreateEvent((mpd_output_get_enabled(next) == true) ? Event::OutputEnabled : Event::OutputDisabled, Data);
+            mpd_output_free(next);
+         }
+
+         CheckError();
+
+         EventData Data;
+         Main::Vimpc::CreateEvent(Event::Repaint, Data);
+      }
+   });
+}
+
+void Client::MixerStatus(struct mpd_status * status)
+{
+   if (static_cast<int32_t>(volume_) != mpd_status_get_volume(status))
+   {
+      volume_ = mpd_status_get_volume(status);
+
+      EventData Data; Data.value = volume_;
+      Main::Vimpc::CreateEvent(Event::Volume, Data);
+   }
+}
+
+void Client::OptionsStatus(struct mpd_status * status)
+{
+   if (random_ != mpd_status_get_random(status))
+   {
+      SetStateAndEvent(Event::Random, random_, mpd_status_get_random(status));
+   }
+
+   if (repeat_ != mpd_status_get_repeat(status))
+   {
+      SetStateAndEvent(Event::Repeat, repeat_, mpd_status_get_repeat(status));
+   }
+
+   if (single_ != mpd_status_get_single(status))
+   {
+      SetStateAndEvent(Event::Single, single_, mpd_status_get_single(status));
+   }
+
+   if (consume_ != mpd_status_get_consume(status))
+   {
+      SetStateAndEvent(Event::Consume, consume_, mpd_status_get_consume(status));
+   }
+
+   if (crossfade_ != (mpd_status_get_crossfade(status) > 0))
+   {
+      crossfade_ = (mpd_status_get_crossfade(status) > 0);
+      EventData Data; Data.state = crossfade_;
+      Main::Vimpc::CreateEvent(Event::Crossfade, Data);
+   }
+
+   if (crossfade_ == true)
+   {
+      if (crossfadeTime_ != mpd_status_get_crossfade(status))
+      {
+         crossfadeTime_ = mpd_status_get_crossfade(status);
+         EventData Data; Data.value = crossfadeTime_;
+         Main::Vimpc::CreateEvent(Event::CrossfadeTime, Data);
+      }
+   }
+}
+
+void Client::UpdateCurrentSong()
+{
+   ClearCommand();
+
+   if ((Connected() == true))
+   {
+      if (listMode_ == false)
+      {
+         Debug("Client::Send get current song");
+         struct mpd_song * song = mpd_run_current_song(connection_);
+         CheckError();
+
+         SetCurrentSong(song);
+         return;
+      }
+   }
+   else
+   {
+      currentSongId_ = -1;
+      currentSongURI_ = "";
+   }
+
+   CurrentSongEvents();
+}
+
+void Client::SetCurrentSong(struct mpd_song * song)
+{
+   if (currentSong_ != NULL)
+   {
+      mpd_song_free(currentSong_);
+   }
+
+   currentSong_    = song;
+   currentSongId_  = -1;
+   currentSongURI_ = "";
+
+   if (currentSong_ != NULL)
+   {
+      currentSongId_  = mpd_song_get_pos(currentSong_);
+      currentSongURI_ = mpd_song_get_uri(currentSong_);
+
+      Debug("Client::Get current song %d:%s", currentSongId_, currentSongURI_.c_str());
+   }
+
+   CurrentSongEvents();
+}
+
+void Client::CurrentSongEvents()
+{
+   EventData IdData; IdData.id = currentSongId_;
+   Main::Vimpc::CreateEvent(Event::CurrentSongId, IdData);
+
+   if (autoscroll_ == true)
+   {
+      Main::Vimpc::CreateEvent(Event::Autoscroll, IdData);
+      autoscroll_ = false;
+   }
+
+   if (currentSong_ != NULL)
+   {
+      EventData SongData; SongData.currentSong = mpd_song_dup(currentSong_);
+      Main::Vimpc::CreateEvent(Event::CurrentSong, SongData);
+   }
+}
+
+void Client::ClientQueueExecutor(Mpc::Client * client)
+{
+   struct timeval start, end;
+   gettimeofday(&start, NULL);
+
+   ASSERT(WakeupPipeOpen == true);
+
+   while (Running == true)
+   {
+      gettimeofday(&end,   NULL);
+      long const seconds  = end.tv_sec  - start.tv_sec;
+      long const useconds = end.tv_usec - start.tv_usec;
+      long const mtime    = (seconds * 1000 + (useconds/1000.0)) + 0.5;
+      IncrementTime(mtime);
+      gettimeofday(&start, NULL);
+
+      if ((listMode_ == false) && (RunInteractiveCommands() == true))
+      {
+         continue;
+      }
+
+      FUNCTION<void()> function;
+      CompletionHandle completion;
+      bool             batchable = false;
+
+      if (Queue.Pop(function, completion, batchable) == true)
+      {
+         ExitIdleMode();
+
+         Chrono::steady_clock::time_point const Start = Chrono::steady_clock::now();
+
+         if ((batchable == true) && (listMode_ == false) && (Connected() == true))
+         {
+            RunBatch(function, completion);
+            Main::Stats::Instance().AddTiming("mpd batch", Main::Stats::Elapsed(Start));
+         }
+         else
+         {
+            function();
+            completion->Signal();
+            Main::Stats::Instance().AddTiming("mpd command", Main::Stats::Elapsed(Start));
+         }
+
+         timeSinceCommand_ = 0;
+         continue;
+      }
+
+      if (listMode_ == false)
+      {
+         if (queueUpdate_ == true)
+         {
+            QueueMetaChanges();
+            continue;
+         }
+         else if ((idleConnection_ == NULL) && (idleMode_ == false))
+         {
+            IdleMode();
+         }
+      }
+
+      if (ResolveSteps() == true)
+      {
+         continue;
+      }
+
+      WaitForActivity(NextTimeout());
+   }
+}
+
+bool Client::ResolveSteps()
+{
+   bool stepped = false;
+
+   // Connections waiting on the resolver are not on the queue, they are
+   // stepped here whenever the executor wakes until the address arrives
+   if ((pending_ != NULL) && (pending_->state_ == PendingConnection::Resolving))
+   {
+      ConnectStep(connectId_);
+      stepped = ((pending_ == NULL) || (pending_->state_ != PendingConnection::Resolving));
+   }
+
+   if ((idlePending_ != NULL) && (idlePending_->state_ == PendingConnection::Resolving))
+   {
+      IdleConnectStep(idleConnectId_);
+      stepped = ((stepped == true) || (idlePending_ == NULL) ||
+                 (idlePending_->state_ != PendingConnection::Resolving));
+   }
+
+   return stepped;
+}
+
+bool Client::RunInteractiveCommands()
+{
+   bool ran = false;
+
+   while (InteractiveReady() == true)
+   {
+      FUNCTION<void()> const function   = NextInteractive.command;
+      CompletionHandle const completion = NextInteractive.completion;
+
+      NextInteractive.held    = false;
+      NextInteractive.command = FUNCTION<void()>();
+      NextInteractive.completion.reset();
+
+      ExitIdleMode();
+
+      Chrono::steady_clock::time_point const Start = Chrono::steady_clock::now();
+      function();
+      completion->Signal();
+      Main::Stats::Instance().AddTiming("mpd interactive", Main::Stats::Elapsed(Start));
+      timeSinceCommand_ = 0;
+      ran = true;
+   }
+
+   return ran;
+}
+
+void Client::RunBatch(FUNCTION<void()> const & function, CompletionHandle const & completion)
+{
+   uint32_t const BatchSize = atoi(settings_.Get(Setting::BatchSize).c_str());
+   int const      Latency   = atoi(settings_.Get(Setting::BatchLatency).c_str());
+
+   ClearCommand();
+
+   if ((BatchSize <= 1) || (mpd_command_list_begin(connection_, false) == false))
+   {
+      CheckError();
+      function();
+      completion->Signal();
+      return;
+   }
+
+   Debug("Client::Batch started");
+   listMode_ = true;
+
+   std::vector<CompletionHandle> Completions;
+
+   function();
+   Completions.push_back(completion);
+
+   FUNCTION<void()> next;
+   CompletionHandle nextCompletion;
+   bool             batchable = false;
+   bool             pending   = false;
+
+   Chrono::steady_clock::time_point const Deadline =
+      Chrono::steady_clock::now() + Chrono::milliseconds(Latency);
+
+   // Keep adding to the batch until something that can't be batched
+   // turns up, or nothing has been queued within the latency
+   while ((Completions.size() < BatchSize) && (InteractiveReady() == false) &&
+          (pending == false) && (Connected() == true))
+   {
+      if (Queue.Pop(next, nextCompletion, batchable) == true)
+      {
+         if (batchable == true)
+         {
+            next();
+            Completions.push_back(nextCompletion);
+         }
+         else
+         {
+            pending = true;
+         }
+      }
+      else
+      {
+         long const Remaining = Chrono::duration_cast<Chrono::milliseconds>(
+            Deadline - Chrono::steady_clock::now()).count();
+
+         if (Remaining <= 0)
+         {
+            break;
+         }
+
+         WaitForWakeup(Remaining);
+      }
+   }
+
+   if (Connected() == true)
+   {
+      Debug("Client::Batch of %u commands", static_cast<uint32_t>(Completions.size()));
+
+      // An ACK for any command in the list only arrives with the response,
+      // so it is read here rather than left for the next command to find
+      bool const Sent = (mpd_command_list_end(connection_) == true);
+      listMode_ = false;
+
+      if ((Sent == true) && (mpd_response_finish(connection_) == true))
+      {
+         EventData Data;
+         Main::Vimpc::CreateEvent(Event::CommandListSend, Data);
+         Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+      }
+      else
+      {
+         CheckError();
+
+         // mpd stops at the first command that fails, but every command in the
+         // batch has already told the playlist what it did. The whole queue is
+         // listed again, as the version may not have changed if nothing ran.
+         oldVersion_  = 0;
+         queueUpdate_ = true;
+      }
+   }
+
+   for (auto Handle : Completions)
+   {
+      Handle->Signal();
+   }
+
+   if (pending == true)
+   {
+      next();
+      nextCompletion->Signal();
+   }
+}
+
+void Client::WaitForActivity(int timeout_ms)
+{
+   pollfd fds[3];
+   nfds_t count = 0;
+
+   fds[count].fd = WakeupPipe[0]; fds[count].events = POLLIN; fds[count].revents = 0; ++count;
+
+   int const Connection = ((idleMode_ == true) && (fd_ != -1)) ? count : -1;
+
+   if (Connection != -1)
+   {
+      fds[count].fd = fd_; fds[count].events = POLLIN; fds[count].revents = 0; ++count;
+   }
+
+   int const Idle = ((idleConnection_ != NULL) && (idleFd_ != -1)) ? count : -1;
+
+   if (Idle != -1)
+   {
+      fds[count].fd = idleFd_; fds[count].events = POLLIN; fds[count].revents = 0; ++count;
+   }
+
+   if (poll(fds, count, timeout_ms) > 0)
+   {
+      if (fds[0].revents != 0)
+      {
+         DrainWakeups();
+      }
+
+      if ((Connection != -1) && (fds[Connection].revents != 0))
+      {
+         CheckForEvents();
+      }
+   }
+
+   // This also keeps the command connection alive, so check it after a timeout too
+   if (Idle != -1)
+   {
+      CheckForIdleEvents();
+   }
+}
+
+int Client::NextTimeout() const
+{
+   long Timeout = -1;
+
+   // Wake up each time the elapsed time ticks over to the next second
+   if (state_ == MPD_STATE_PLAY)
+   {
+      Timeout = 1000 - (timeSinceUpdate_ % 1000);
+   }
+
+   if (settings_.Get(Setting::Polling) == true)
+   {
+      long const Poll = std::max(0L, PollIntervalMs + 1 - timeSinceUpdate_);
+      Timeout = (Timeout == -1) ? Poll : std::min(Timeout, Poll);
+   }
+
+   if (idleConnection_ != NULL)
+   {
+      long const KeepAlive = std::max(0L, KeepAliveMs - timeSinceCommand_);
+      Timeout = (Timeout == -1) ? KeepAlive : std::min(Timeout, KeepAlive);
+   }
+
+   if (timeToReconnect_ >= 0)
+   {
+      Timeout = (Timeout == -1) ? timeToReconnect_ : std::min(Timeout, timeToReconnect_);
+   }
+
+   if (timeToUpdate_ >= 0)
+   {
+      Timeout = (Timeout == -1) ? timeToUpdate_ : std::min(Timeout, timeToUpdate_);
+   }
+
+   // A connection waiting on the resolver has to wake up to time out
+   PendingConnection const * const Pendings[] = { pending_, idlePending_ };
+
+   for (auto pending : Pendings)
+   {
+      if ((pending != NULL) && (pending->state_ == PendingConnection::Resolving))
+      {
+         long const Deadline = std::max(0L, pending->TimeLeft() + 1);
+         Timeout = (Timeout == -1) ? Deadline : std::min(Timeout, Deadline);
+      }
+   }
+
+   return static_cast<int>(Timeout);
+}
+
+
+void Client::ClearCommand()
+{
+	error_ = false;
+
+   if ((listMode_ == false) && (idleMode_ == false) && (Connected() == true))
+   {
+      Debug("Client::Finish the response");
+      mpd_response_finish(connection_);
+      CheckError();
+   }
+}
+
+bool Client::IsPasswordRequired()
+{
+   Debug("Client::Trying status update to determine if password required");
+
+   bool Result = false;
+
+   if (Connected() == true)
+   {
+      struct mpd_status * status = mpd_run_status(connection_);
+
+      mpd_error error = mpd_connection_get_error(connection_);
+
+      if (error != MPD_ERROR_SUCCESS)
+      {
+         if ((error == MPD_ERROR_SERVER) &&
+            (mpd_connection_get_server_error(connection_) == MPD_SERVER_ERROR_PERMISSION))
+         {
+            Result = true;
+         }
+
+         mpd_connection_clear_error(connection_);
+      }
+
+      if (status != NULL)
+      {
+         mpd_status_free(status);
+      }
+   }
+
+   return Result;
+}
+
+
+void Client::GetAllMetaInformation()
+{
+   ClearCommand();
+
+   std::vector<Mpc::Song *> songs;
+   std::vector<std::string> paths;
+   std::vector<std::pair<std::string, std::string> > lists;
+
+   if (Connected() == true)
+   {
+      EventData DBData;
+      Main::Vimpc::CreateEvent(Event::ClearDatabase, DBData);
+
+      Debug("Client::Get all meta information");
+
+      bool     const LazyTags = (settings_.Get(Setting::LazyTags) == true);
+      bool     const UseCache = (settings_.Get(Setting::LibraryCache) == true) && (LazyTags == false);
+      uint64_t       DBUpdate = 0;
+      bool           Cached   = false;
+
+      Mpc::LibraryCache Cache(hostname_, port_);
+
+      // The version of the database is also kept to see if the library
+      // can be reused after reconnecting
+      dbUpdate_ = 0;
+
+      if ((settings_.Get(Setting::ListAllMeta) == true) &&
+          (ServerStats(DBUpdate, serverStarted_, dbSongs_) == true) && (UseCache == true))
+      {
+         // Only use the snapshot if it was taken of this version of the database
+         Cached = Cache.Load(DBUpdate, dbSongs_, songs, paths, lists);
+      }
+
+      if ((settings_.Get(Setting::ListAllMeta) == true) && (LazyTags == true) && (Connected() == true))
+      {
+         Debug("Client::List all without tags");
+         mpd_send_list_all(connection_, "");
+
+         mpd_entity * nextEntity = mpd_recv_entity(connection_);
+
+         for(; nextEntity != NULL; nextEntity = mpd_recv_entity(connection_))
+         {
+            AddEntity(nextEntity, songs, paths, lists);
+            mpd_entity_free(nextEntity);
+         }
+
+         // The tags are only fetched once something needs to show them
+         for (auto song : songs)
+         {
+            song->SetTagState(Mpc::Song::TagsMissing);
+         }
+      }
+      else if ((settings_.Get(Setting::ListAllMeta) == true) && (Cached == false) &&
+               (settings_.Get(Setting::NativeParser) == true) && (Connected() == true))
+      {
+         Debug("Client::List all meta with the native parser");
+
+         ResponseParser Parser(fd_, connectTimeout_);
+
+         bool const Listed = (Parser.Send("listallinfo") == true) &&
+            (Parser.Receive([&songs] (Mpc::Song * song, int32_t position, int32_t id) { songs.push_back(song); return true; },
+                            [&paths] (char const * path, size_t length) { paths.push_back(std::string(path, length)); },
+                            [&lists] (char const * path, size_t length)
+                            {
+                               std::string const Path(path, length);
+                               lists.push_back(std::make_pair(Mpc::Directory::FileFromURI(Path), Path));
+                            }) == true);
+
+         if (Listed == true)
+         {
+            if ((UseCache == true) && (DBUpdate != 0))
+            {
+               Cache.Save(DBUpdate, dbSongs_, songs, paths, lists);
+            }
+         }
+         else
+         {
+            NativeParserFailed(Parser);
+         }
+      }
+      else if ((settings_.Get(Setting::ListAllMeta) == true) && (Cached == false) &&
+               (atoi(settings_.Get(Setting::LoadConnections).c_str()) > 1) &&
+               (ParallelListAll(atoi(settings_.Get(Setting::LoadConnections).c_str()), songs, paths, lists) == true))
+      {
+         if ((UseCache == true) && (DBUpdate != 0))
+         {
+            Cache.Save(DBUpdate, dbSongs_, songs, paths, lists);
+         }
+      }
+      else if ((settings_.Get(Setting::ListAllMeta) == true) && (Cached == false) && (Connected() == true))
+      {
+          mpd_send_list_all_meta(connection_, NULL);
+
+          mpd_entity * nextEntity = mpd_recv_entity(connection_);
+
+          for(; nextEntity != NULL; nextEntity = mpd_recv_entity(connection_))
+          {
+             AddEntity(nextEntity, songs, paths, lists);
+             mpd_entity_free(nextEntity);
+          }
+
+          if ((UseCache == true) && (DBUpdate != 0) &&
+              (mpd_connection_get_error(connection_) == MPD_ERROR_SUCCESS))
+          {
+             Cache.Save(DBUpdate, dbSongs_, songs, paths, lists);
+          }
+       }
+
+      if (Connected() == true)
+      {
+         dbUpdate_ = DBUpdate;
+      }
+   }
+
+   ClearCommand();
+
+   if (error_)
+   {
+       dbUpdate_ = 0;
+       Debug("List all failed, disabling\n");
+       Error(ErrorNumber::ErrorClear, "");
+       ErrorString(ErrorNumber::ClientNoMeta, "not supported on server");
+       settings_.Set(Setting::ListAllMeta, false);
+   }
+
+   EventData DatabaseEvent;
+   DatabaseEvent.state = (settings_.Get(Setting::ListAllMeta));
+   Main::Vimpc::CreateEvent(Event::DatabaseEnabled, DatabaseEvent);
+
+   if (Connected() == true)
+   {
+      // Songs, paths, lists, etc are collated and the events created this way
+      // because mpd seems to disconnect you if you take to long to recv entities
+      DatabaseSongEvents(songs);
+
+      EventData PathData; PathData.Payload().uris = paths;
+      Main::Vimpc::CreateEvent(Event::DatabasePaths, std::move(PathData));
+
+      for (auto list : lists)
+      {
+         EventData Data; Data.name = list.first; Data.uri = list.second;
+         Main::Vimpc::CreateEvent(Event::DatabaseListFile, Data);
+      }
+   }
+
+   songs.clear();
+   queueIds_.clear();
+
+   if ((Connected() == true) && (settings_.Get(Setting::NativeParser) == true))
+   {
+      Debug("Client::List queue meta data with the native parser");
+
+      ResponseParser Parser(fd_, connectTimeout_);
+      bool const     ListAllMeta = settings_.Get(Setting::ListAllMeta);
+
+      bool const Listed = (Parser.Send("playlistinfo") == true) &&
+         (Parser.Receive([this, &songs, ListAllMeta] (Mpc::Song * song, int32_t position, int32_t id)
+                         {
+                            EventData Data; Data.song = NULL; Data.uri = song->URI(); Data.pos1 = -1;
+
+                            if ((id >= 0) && (song->VirtualEnd() == 0))
+                            {
+                               queueIds_[id] = Data.uri;
+                            }
+
+                            if (((ListAllMeta == false) &&
+                                 (Main::Library().Song(Data.uri) == NULL)) ||
+                                // Handle "virtual" songs embedded within files
+                                (song->VirtualEnd() != 0))
+                            {
+                               Data.song = song;
+
+                               if (ListAllMeta == false) {
+                                  songs.push_back(song);
+                               }
+                            }
+
+                            Main::Vimpc::CreateEvent(Event::PlaylistAdd, Data);
+                            return (Data.song != NULL);
+                         },
+                         [] (char const * path, size_t length) { },
+                         [] (char const * path, size_t length) { }) == true);
+
+      if (Listed == false)
+      {
+         NativeParserFailed(Parser);
+      }
+   }
+   else if (Connected() == true)
+   {
+      Debug("Client::List queue meta data");
+      mpd_send_list_queue_meta(connection_);
+
+      mpd_song * nextSong = mpd_recv_song(connection_);
+
+      for (; nextSong != NULL; nextSong = mpd_recv_song(connection_))
+      {
+         EventData Data; Data.song = NULL; Data.uri = mpd_song_get_uri(nextSong); Data.pos1 = -1;
+
+         if (mpd_song_get_end(nextSong) == 0)
+         {
+            queueIds_[mpd_song_get_id(nextSong)] = Data.uri;
+         }
+
+         if (((settings_.Get(Setting::ListAllMeta) == false) &&
+              (Main::Library().Song(Data.uri) == NULL)) ||
+             // Handle "virtual" songs embedded within files
+             (mpd_song_get_end(nextSong) != 0))
+         {
+            Song * const newSong = CreateSong(nextSong);
+            Data.song = newSong;
+
+            if (settings_.Get(Setting::ListAllMeta) == false) {
+               songs.push_back(newSong);
+            }
+         }
+
+         Main::Vimpc::CreateEvent(Event::PlaylistAdd, Data);
+
+         mpd_song_free(nextSong);
+      }
+   }
+
+   if (settings_.Get(Setting::ListAllMeta) == false) {
+      if (Connected() == true)
+      {
+         // Songs, paths, lists, etc are collated and the events created this way
+         // because mpd seems to disconnect you if you take to long to recv entities
+         DatabaseSongEvents(songs);
+      }
+   }
+
+   if (Connected() == true)
+   {
+#if LIBMPDCLIENT_CHECK_VERSION(2,5,0)
+      ClearCommand();
+
+      if (Connected() == true)
+      {
+         Debug("Client::Request playlists");
+
+         if (mpd_send_list_playlists(connection_))
+         {
+            mpd_playlist * nextPlaylist = mpd_recv_playlist(connection_);
+
+            for(; nextPlaylist != NULL; nextPlaylist = mpd_recv_playlist(connection_))
+            {
+               std::string const playlist = mpd_playlist_get_path(nextPlaylist);
+
+               EventData Data; Data.uri = playlist; Data.name = playlist;
+               Main::Vimpc::CreateEvent(Event::DatabaseList, Data);
+
+               mpd_playlist_free(nextPlaylist);
+            }
+         }
+
+         mpd_connection_clear_error(connection_);
+      }
+#endif
+   }
+
+   if (Connected() == true)
+   {
+      EventData Data;
+      Main::Vimpc::CreateEvent(Event::AllMetaDataReady, Data);
+      Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+   }
+
+#if !LIBMPDCLIENT_CHECK_VERSION(2,5,0)
+   GetAllMetaFromRoot();
+#endif
+}
+
+uint32_t Client::FetchTags(std::vector<Mpc::Song *> const & songs, bool notify)
+{
+   std::vector<std::string> const URIs = TagRequests(songs);
+   bool Waiting = (URIs.empty() == false);
+
+   for (auto song : songs)
+   {
+      Waiting = ((Waiting == true) || ((song != NULL) && (song->Tags() != Mpc::Song::TagsLoaded)));
+   }
+
+   if ((Waiting == false) || ((URIs.empty() == true) && (notify == false)))
+   {
+      return 0;
+   }
+
+   // Songs requested earlier are listed by a command queued before this one,
+   // so they have their tags too by the time this one has run
+   uint32_t Request = 0;
+
+   if (notify == true)
+   {
+      // 0 is returned when nothing is waiting so it is never an id
+      if (++tagRequest_ == 0)
+      {
+         ++tagRequest_;
+      }
+
+      Request = tagRequest_;
    }
+
+   QueueCommand([this, URIs, Request] ()
+   {
+      if (URIs.empty() == false)
+      {
+         EventData Data;
+         ListTags(URIs, Data.Payload().songs, Data.Payload().uris);
+         Main::Vimpc::CreateEvent(Event::SongTags, std::move(Data));
+         Main::Vimpc::CreateEvent(Event::Repaint, EventData());
+      }
+
+      if (Request != 0)
+      {
+         EventData Data; Data.id = Request;
+         Main::Vimpc::CreateEvent(Event::TagsApplied, Data);
+      }
+   });
+
+   return Request;
 }
 
-bool Client::IsPasswordRequired()
+std::vector<std::string> Client::TagRequests(std::vector<Mpc::Song *> const & songs) const
 {
-   Debug("Client::Trying status update to determine if password required");
+   std::vector<std::string> URIs;
 
-   bool Result = false;
+   for (auto song : songs)
+   {
+      if ((song != NULL) && (song->Tags() == Mpc::Song::TagsMissing))
+      {
+         song->SetTagState(Mpc::Song::TagsRequested);
+         URIs.push_back(song->URI());
+      }
+   }
 
-   if (Connected() == true)
+   return URIs;
+}
+
+void Client::ListTags(std::vector<std::string> const & uris, std::vector<Mpc::Song *> & songs,
+                      std::vector<std::string> & unanswered)
+{
+   ClearCommand();
+
+   size_t i = 0;
+
+   while ((i < uris.size()) && (Connected() == true))
    {
-      struct mpd_status * status = mpd_run_status(connection_);
+      size_t const End = std::min(uris.size(), i + TagBatchSize);
 
-      mpd_error error = mpd_connection_get_error(connection_);
+      Debug("Client::List tags for %d songs", static_cast<int>(End - i));
 
-      if (error != MPD_ERROR_SUCCESS)
+      bool Sent = (mpd_command_list_begin(connection_, true) == true);
+
+      for (size_t j = i; ((j < End) && (Sent == true)); ++j)
       {
-         if ((error == MPD_ERROR_SERVER) &&
-            (mpd_connection_get_server_error(connection_) == MPD_SERVER_ERROR_PERMISSION))
+         Sent = (mpd_send_list_meta(connection_, uris[j].c_str()) == true);
+      }
+
+      Sent = ((Sent == true) && (mpd_command_list_end(connection_) == true));
+
+      // Every uri before this one has had its whole response read
+      size_t Replied = i;
+      bool   Next    = Sent;
+
+      while ((Replied < End) && (Next == true))
+      {
+         mpd_song * nextSong = mpd_recv_song(connection_);
+
+         for (; nextSong != NULL; nextSong = mpd_recv_song(connection_))
          {
-            Result = true;
+            songs.push_back(CreateSong(nextSong));
+            mpd_song_free(nextSong);
          }
 
-         mpd_connection_clear_error(connection_);
+         if (mpd_connection_get_error(connection_) == MPD_ERROR_SUCCESS)
+         {
+            ++Replied;
+            Next = ((Replied == End) || (mpd_response_next(connection_) == true));
+         }
+         else
+         {
+            Next = false;
+         }
       }
 
-      if (status != NULL)
+      if ((Sent == true) && (Replied == End))
       {
-         mpd_status_free(status);
+         Sent = (mpd_response_finish(connection_) == true);
+      }
+
+      if (mpd_connection_get_error(connection_) == MPD_ERROR_SERVER)
+      {
+         // A song that has gone from the database fails the rest of the list,
+         // but the connection is fine so the songs after it are asked for again
+         size_t const Failed = std::min(End - 1, std::max(Replied,
+                               i + mpd_connection_get_server_error_location(connection_)));
+
+         Debug("Client::No tags for %s: %s", uris[Failed].c_str(),
+               mpd_connection_get_error_message(connection_));
+
+         mpd_connection_clear_error(connection_);
+         i = Failed + 1;
+      }
+      else if ((Sent == false) || (Replied != End))
+      {
+         // The connection has gone, songs that got no reply are left to the caller
+         unanswered.insert(unanswered.end(), uris.begin() + Replied, uris.end());
+         CheckError();
+         return;
+      }
+      else
+      {
+         i = End;
       }
    }
 
-   return Result;
+   unanswered.insert(unanswered.end(), uris.begin() + i, uris.end());
 }
 
-
-void Client::GetAllMetaInformation()
+void Client::AddEntity(mpd_entity const * entity, std::vector<Mpc::Song *> & songs,
+                       std::vector<std::string> & paths, ListFiles & lists) const
 {
-   ClearCommand();
+   if (mpd_entity_get_type(entity) == MPD_ENTITY_TYPE_SONG)
+   {
+      mpd_song const * const nextSong = mpd_entity_get_song(entity);
 
-   std::string const SongFormat = settings_.Get(Setting::SongFormat);
+      if (nextSong != NULL)
+      {
+         Song * const newSong = CreateSong(nextSong);
+         songs.push_back(newSong);
+      }
+   }
+   else if (mpd_entity_get_type(entity) == MPD_ENTITY_TYPE_DIRECTORY)
+   {
+      mpd_directory const * const nextDirectory = mpd_entity_get_directory(entity);
+      paths.push_back(std::string(mpd_directory_get_path(nextDirectory)));
+   }
+   else if (mpd_entity_get_type(entity) == MPD_ENTITY_TYPE_PLAYLIST)
+   {
+      mpd_playlist const * const nextPlaylist = mpd_entity_get_playlist(entity);
 
-   std::vector<Mpc::Song *> songs;
-   std::vector<std::string> paths;
-   std::vector<std::pair<std::string, std::string> > lists;
+      if (nextPlaylist != NULL)
+      {
+         std::string const path = mpd_playlist_get_path(nextPlaylist);
+         std::string name = path;
 
-   if (Connected() == true)
+         if (name.find("/") != std::string::npos)
+         {
+            name = name.substr(name.find_last_of("/") + 1);
+         }
+
+         lists.push_back(std::make_pair(name, path));
+      }
+   }
+}
+
+namespace
+{
+   // A top level directory listed by one of the parallel loader's connections
+   struct Partition
    {
-      EventData DBData;
-      Main::Vimpc::CreateEvent(Event::ClearDatabase, DBData);
+      Partition(std::string const & path) : path(path), done(false), failed(false) { }
 
-      Debug("Client::Get all meta information");
+      std::string                path;
+      std::vector<mpd_entity *>  entities;
+      bool                       done;
+      bool                       failed;
+   };
+}
 
-      if ((settings_.Get(Setting::ListAllMeta) == true))
-      {
-          mpd_send_list_all_meta(connection_, NULL);
+bool Client::ParallelListAll(uint32_t connections, std::vector<Mpc::Song *> & songs,
+                             std::vector<std::string> & paths, ListFiles & lists)
+{
+   ClearCommand();
 
-          mpd_entity * nextEntity = mpd_recv_entity(connection_);
+   if (Connected() == false)
+   {
+      return false;
+   }
 
-          for(; nextEntity != NULL; nextEntity = mpd_recv_entity(connection_))
-          {
-             if (mpd_entity_get_type(nextEntity) == MPD_ENTITY_TYPE_SONG)
-             {
-                mpd_song const * const nextSong = mpd_entity_get_song(nextEntity);
-
-                if (nextSong != NULL)
-                {
-                   Song * const newSong = CreateSong(nextSong);
-                   songs.push_back(newSong);
-                }
-             }
-             else if (mpd_entity_get_type(nextEntity) == MPD_ENTITY_TYPE_DIRECTORY)
-             {
-                mpd_directory const * const nextDirectory = mpd_entity_get_directory(nextEntity);
-                paths.push_back(std::string(mpd_directory_get_path(nextDirectory)));
-             }
-             else if (mpd_entity_get_type(nextEntity) == MPD_ENTITY_TYPE_PLAYLIST)
-             {
-                mpd_playlist const * const nextPlaylist = mpd_entity_get_playlist(nextEntity);
-
-                if (nextPlaylist != NULL)
-                {
-                   std::string const path = mpd_playlist_get_path(nextPlaylist);
-                   std::string name = path;
-
-                   if (name.find("/") != std::string::npos)
-                   {
-                      name = name.substr(name.find_last_of("/") + 1);
-                   }
+   // Everything in the root directory is added as it is, each directory
+   // in it is listed in full by whichever connection gets to it first
+   std::vector<mpd_entity *> root;
+   std::vector<Partition>    partitions;
 
-                   lists.push_back(std::make_pair(name, path));
-                }
-             }
+   Debug("Client::List root directory");
 
-             mpd_entity_free(nextEntity);
-          }
-       }
+   if (mpd_send_list_meta(connection_, "") == true)
+   {
+      mpd_entity * nextEntity = mpd_recv_entity(connection_);
+
+      for(; nextEntity != NULL; nextEntity = mpd_recv_entity(connection_))
+      {
+         root.push_back(nextEntity);
+
+         if (mpd_entity_get_type(nextEntity) == MPD_ENTITY_TYPE_DIRECTORY)
+         {
+            partitions.push_back(Partition(mpd_directory_get_path(mpd_entity_get_directory(nextEntity))));
+         }
+      }
    }
 
    ClearCommand();
 
-   if (error_)
+   if ((error_ == true) || (Connected() == false))
    {
-       Debug("List all failed, disabling\n");
-       Error(ErrorNumber::ErrorClear, "");
-       ErrorString(ErrorNumber::ClientNoMeta, "not supported on server");
-       settings_.Set(Setting::ListAllMeta, false);
+      for (auto entity : root)
+      {
+         mpd_entity_free(entity);
+      }
+
+      return false;
    }
 
-   EventData DatabaseEvent;
-   DatabaseEvent.state = (settings_.Get(Setting::ListAllMeta));
-   Main::Vimpc::CreateEvent(Event::DatabaseEnabled, DatabaseEvent);
+   Mutex               PartitionMutex;
+   ConditionVariable   PartitionDone;
+   Atomic(uint32_t)    Next(0);
+   std::vector<Thread> Workers;
 
-   if (Connected() == true)
+   std::string const Hostname = hostname_;
+   uint16_t    const Port     = port_;
+   uint32_t    const Timeout  = connectTimeout_;
+   std::string const Password = password_;
+
+   auto Worker = [&partitions, &PartitionMutex, &PartitionDone, &Next, Hostname, Port, Timeout, Password] ()
    {
-      // Songs, paths, lists, etc are collated and the events created this way
-      // because mpd seems to disconnect you if you take to long to recv entities
-      for (auto song : songs)
+      struct mpd_connection * connection = mpd_connection_new(Hostname.c_str(), Port, Timeout);
+
+      if ((connection != NULL) &&
+          ((mpd_connection_get_error(connection) != MPD_ERROR_SUCCESS) ||
+           ((Password != "") && (mpd_run_password(connection, Password.c_str()) == false))))
       {
-         // Pre cache the print of the song
-         (void) song->FormatString(SongFormat);
-         EventData Data; Data.song = song;
-         Main::Vimpc::CreateEvent(Event::DatabaseSong, Data);
+         mpd_connection_free(connection);
+         connection = NULL;
       }
 
-      for (auto path : paths)
+      for (uint32_t i = Next++; i < partitions.size(); i = Next++)
       {
-         EventData Data; Data.uri = path;
-         Main::Vimpc::CreateEvent(Event::DatabasePath, Data);
+         Partition & partition = partitions[i];
+         std::vector<mpd_entity *> entities;
+         bool failed = (connection == NULL);
+
+         if ((failed == false) && (mpd_send_list_all_meta(connection, partition.path.c_str()) == true))
+         {
+            mpd_entity * nextEntity = mpd_recv_entity(connection);
+
+            for(; nextEntity != NULL; nextEntity = mpd_recv_entity(connection))
+            {
+               entities.push_back(nextEntity);
+            }
+         }
+
+         if ((failed == false) &&
+             ((mpd_response_finish(connection) == false) ||
+              (mpd_connection_get_error(connection) != MPD_ERROR_SUCCESS)))
+         {
+            failed = true;
+         }
+
+         UniqueLock<Mutex> Lock(PartitionMutex);
+         partition.entities.swap(entities);
+         partition.failed = failed;
+         partition.done   = true;
+         PartitionDone.notify_all();
       }
 
-      for (auto list : lists)
+      if (connection != NULL)
       {
-         EventData Data; Data.name = list.first; Data.uri = list.second;
-         Main::Vimpc::CreateEvent(Event::DatabaseListFile, Data);
+         mpd_connection_free(connection);
       }
-   }
+   };
 
-   songs.clear();
+   connections = std::min<uint32_t>(connections, partitions.size());
 
-   if (Connected() == true)
+   Debug("Client::List %u directories over %u connections", static_cast<uint32_t>(partitions.size()), connections);
+
+   for (uint32_t i = 0; i < connections; ++i)
    {
-      Debug("Client::List queue meta data");
-      mpd_send_list_queue_meta(connection_);
+      Workers.push_back(Thread(Worker));
+   }
 
-      mpd_song * nextSong = mpd_recv_song(connection_);
+   // The songs are created here, in the order of the root directory, as each
+   // partition arrives so that the result is always the same and the tags are
+   // only ever interned from this thread
+   bool     failed    = false;
+   uint32_t partition = 0;
 
-      for (; nextSong != NULL; nextSong = mpd_recv_song(connection_))
+   for (auto entity : root)
+   {
+      AddEntity(entity, songs, paths, lists);
+
+      if (mpd_entity_get_type(entity) == MPD_ENTITY_TYPE_DIRECTORY)
       {
-         EventData Data; Data.song = NULL; Data.uri = mpd_song_get_uri(nextSong); Data.pos1 = -1;
+         std::vector<mpd_entity *> entities;
 
-         if (((settings_.Get(Setting::ListAllMeta) == false) &&
-              (Main::Library().Song(Data.uri) == NULL)) ||
-             // Handle "virtual" songs embedded within files
-             (mpd_song_get_end(nextSong) != 0))
          {
-            Song * const newSong = CreateSong(nextSong);
-            Data.song = newSong;
+            UniqueLock<Mutex> Lock(PartitionMutex);
 
-            if (settings_.Get(Setting::ListAllMeta) == false) {
-               songs.push_back(newSong);
+            while (partitions[partition].done == false)
+            {
+               PartitionDone.wait(Lock);
             }
+
+            entities.swap(partitions[partition].entities);
+            failed = (failed || partitions[partition].failed);
          }
 
-         Main::Vimpc::CreateEvent(Event::PlaylistAdd, Data);
+         for (auto partitionEntity : entities)
+         {
+            if (failed == false)
+            {
+               AddEntity(partitionEntity, songs, paths, lists);
+            }
 
-         mpd_song_free(nextSong);
+            mpd_entity_free(partitionEntity);
+         }
+
+         ++partition;
       }
+
+      mpd_entity_free(entity);
    }
 
-   if (settings_.Get(Setting::ListAllMeta) == false) {
-      if (Connected() == true)
+   for (auto & worker : Workers)
+   {
+      worker.join();
+   }
+
+   if (failed == true)
+   {
+      Debug("Client::Parallel list failed, listing everything on one connection");
+
+      for (auto song : songs)
+      {
+         delete song;
+      }
+
+      songs.clear();
+      paths.clear();
+      lists.clear();
+   }
+
+   return (failed == false);
+}
+
+void Client::NativeParserFailed(ResponseParser const & parser)
+{
+   Debug("Client::Native parser failed %s", parser.Error().c_str());
+
+   if (parser.ServerError() == true)
+   {
+      error_ = true;
+      ErrorString(ErrorNumber::ClientError, parser.Error());
+   }
+   else
+   {
+      // libmpdclient has no idea what is left on the socket now
+      ErrorString(ErrorNumber::ClientError, parser.Error());
+      DeleteConnection();
+   }
+}
+
+void Client::DatabaseSongEvents(std::vector<Mpc::Song *> const & songs)
+{
+   std::string const SongFormat = settings_.Get(Setting::SongFormat);
+
+   for (size_t i = 0; i < songs.size(); i += DatabaseBatchSize)
+   {
+      size_t const End = std::min(songs.size(), i + DatabaseBatchSize);
+
+      EventData Data;
+      Data.Payload().songs.assign(songs.begin() + i, songs.begin() + End);
+
+      // Pre cache the print of the songs
+      for (auto song : Data.Payload().songs)
+      {
+         (void) song->FormatString(SongFormat);
+      }
+
+      Main::Vimpc::CreateEvent(Event::DatabaseSongs, std::move(Data));
+   }
+}
+
+bool Client::ModifiedPaths(std::vector<std::string> & paths)
+{
+   bool Result = false;
+
+#if LIBMPDCLIENT_CHECK_VERSION(2,10,0)
+   uint64_t DBUpdate = 0;
+   time_t   Started  = 0;
+   uint32_t Songs    = 0;
+
+   // Songs that were removed cannot be found this way, if there are fewer
+   // than before, or more than can be accounted for by those modified, the
+   // whole database has to be listed again
+   if ((dbUpdate_ == 0) || (ServerStats(DBUpdate, Started, Songs) == false) || (Songs < dbSongs_))
+   {
+      return false;
+   }
+
+   ClearCommand();
+
+   std::set<std::string> Directories;
+   uint32_t              Modified = 0;
+
+   if ((mpd_search_db_songs(connection_, true) == true) &&
+       (mpd_search_add_modified_since(connection_, MPD_OPERATOR_DEFAULT, static_cast<time_t>(dbUpdate_)) == true) &&
+       (mpd_search_commit(connection_) == true))
+   {
+      for (mpd_song * song = mpd_recv_song(connection_); song != NULL; song = mpd_recv_song(connection_))
+      {
+         std::string const URI   = mpd_song_get_uri(song);
+         size_t const      Slash = URI.rfind('/');
+
+         Directories.insert((Slash != std::string::npos) ? URI.substr(0, Slash) : "");
+         ++Modified;
+         mpd_song_free(song);
+      }
+
+      Result = ((mpd_connection_get_error(connection_) == MPD_ERROR_SUCCESS) &&
+                (Songs <= dbSongs_ + Modified));
+   }
+
+   ClearCommand();
+
+   if (Result == true)
+   {
+      Debug("Client::%u songs modified in %u directories", Modified, static_cast<uint32_t>(Directories.size()));
+      paths.assign(Directories.begin(), Directories.end());
+   }
+#endif
+
+   return Result;
+}
+
+void Client::GetUpdatedMetaInformation()
+{
+   std::vector<std::string> Paths = updatePaths_;
+   std::sort(Paths.begin(), Paths.end());
+
+   std::string Previous = "";
+
+   for (auto const & Path : Paths)
+   {
+      // Skip anything contained in a path that has already been listed
+      if ((Previous != "") &&
+          ((Path == Previous) || (Path.compare(0, Previous.size() + 1, Previous + "/") == 0)))
       {
-         // Songs, paths, lists, etc are collated and the events created this way
-         // because mpd seems to disconnect you if you take to long to recv entities
-         for (auto song : songs)
-         {
-            // Pre cache the print of the song
-            (void) song->FormatString(SongFormat);
-            EventData Data; Data.song = song;
-            Main::Vimpc::CreateEvent(Event::DatabaseSong, Data);
-         }
+         continue;
       }
-   }
 
-   if (Connected() == true)
-   {
-#if LIBMPDCLIENT_CHECK_VERSION(2,5,0)
+      Previous = Path;
+
       ClearCommand();
 
-      if (Connected() == true)
+      if (Connected() == false)
       {
-         Debug("Client::Request playlists");
+         break;
+      }
 
-         if (mpd_send_list_playlists(connection_))
-         {
-            mpd_playlist * nextPlaylist = mpd_recv_playlist(connection_);
+      Debug("Client::Get meta information for %s", Path.c_str());
 
-            for(; nextPlaylist != NULL; nextPlaylist = mpd_recv_playlist(connection_))
+      std::string const SongFormat = settings_.Get(Setting::SongFormat);
+
+      EventData Data;
+      Data.uri = Path;
+
+      bool IsSong = false;
+
+      if (mpd_send_list_all_meta(connection_, Path.c_str()) == true)
+      {
+         mpd_entity * nextEntity = mpd_recv_entity(connection_);
+
+         for(; nextEntity != NULL; nextEntity = mpd_recv_entity(connection_))
+         {
+            if (mpd_entity_get_type(nextEntity) == MPD_ENTITY_TYPE_SONG)
             {
-               std::string const playlist = mpd_playlist_get_path(nextPlaylist);
+               mpd_song const * const nextSong = mpd_entity_get_song(nextEntity);
 
-               EventData Data; Data.uri = playlist; Data.name = playlist;
-               Main::Vimpc::CreateEvent(Event::DatabaseList, Data);
+               if (nextSong != NULL)
+               {
+                  Song * const newSong = CreateSong(nextSong);
+                  (void) newSong->FormatString(SongFormat);
+                  Data.Payload().songs.push_back(newSong);
+                  IsSong = (IsSong == true) || (newSong->URI() == Path);
+               }
+            }
+            else if (mpd_entity_get_type(nextEntity) == MPD_ENTITY_TYPE_DIRECTORY)
+            {
+               mpd_directory const * const nextDirectory = mpd_entity_get_directory(nextEntity);
+               Data.Payload().uris.push_back(std::string(mpd_directory_get_path(nextDirectory)));
+            }
+            else if (mpd_entity_get_type(nextEntity) == MPD_ENTITY_TYPE_PLAYLIST)
+            {
+               mpd_playlist const * const nextPlaylist = mpd_entity_get_playlist(nextEntity);
 
-               mpd_playlist_free(nextPlaylist);
+               if (nextPlaylist != NULL)
+               {
+                  Data.Payload().listfiles.push_back(mpd_playlist_get_path(nextPlaylist));
+               }
             }
+
+            mpd_entity_free(nextEntity);
          }
+      }
+
+      bool Exists = true;
 
+      if ((mpd_connection_get_error(connection_) == MPD_ERROR_SERVER) &&
+          (mpd_connection_get_server_error(connection_) == MPD_SERVER_ERROR_NO_EXIST))
+      {
+         // The path has been removed from the database
+         Exists = false;
          mpd_connection_clear_error(connection_);
       }
-#endif
+      else if (CheckError() == true)
+      {
+         for (auto song : Data.Payload().songs)
+         {
+            delete song;
+         }
+
+         break;
+      }
+
+      if ((Exists == true) && (IsSong == false))
+      {
+         Data.Payload().uris.insert(Data.Payload().uris.begin(), Path);
+      }
+
+      Main::Vimpc::CreateEvent(Event::DatabasePathUpdate, std::move(Data));
    }
 
    if (Connected() == true)
    {
       EventData Data;
-      Main::Vimpc::CreateEvent(Event::AllMetaDataReady, Data);
-      Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+      Main::Vimpc::CreateEvent(Event::Repaint, Data);
    }
-
-#if !LIBMPDCLIENT_CHECK_VERSION(2,5,0)
-   GetAllMetaFromRoot();
-#endif
 }
 
 void Client::GetAllOutputs()
@@ -2358,8 +4713,57 @@ void Client::UpdateStatus(bool ExpectUpdate)
             currentStatus_ = NULL;
          }
 
+         // The current song is only requested along with the status when it
+         // is likely to have changed, and the queue changes whenever nothing
+         // else is waiting to modify the queue, so that normally a track
+         // change only needs a single round trip
+         bool const FetchSong    = (((mpdstate_ != MPD_STATE_STOP) && (currentSong_ == NULL)) ||
+                                    ((currentSong_ != NULL) &&
+                                     (mpd_song_get_duration(currentSong_) > 0) &&
+                                     (elapsed_ >= mpd_song_get_duration(currentSong_) - 3)));
+         bool const FetchChanges = ((queueVersion_ > -1) && (queueUpdate_ == false) &&
+                                    (Queue.Empty() == true) && (InteractiveEmpty() == true));
+
+         struct mpd_status * status      = NULL;
+         struct mpd_song   * fetchedSong = NULL;
+         EventData           ChangeData;
+         QueueChanges        Changes;
+         bool                Brief       = false;
+
          Debug("Client::Get current status");
-         struct mpd_status * status = mpd_run_status(connection_);
+
+         if (mpd_command_list_begin(connection_, true) == true)
+         {
+            mpd_send_status(connection_);
+
+            if (FetchSong == true)
+            {
+               mpd_send_current_song(connection_);
+            }
+
+            if (FetchChanges == true)
+            {
+               Brief = SendQueueChanges(queueVersion_);
+            }
+
+            if (mpd_command_list_end(connection_) == true)
+            {
+               status = mpd_recv_status(connection_);
+
+               if ((status != NULL) && (FetchSong == true) && (mpd_response_next(connection_) == true))
+               {
+                  fetchedSong = mpd_recv_song(connection_);
+               }
+
+               if ((status != NULL) && (FetchChanges == true) && (mpd_response_next(connection_) == true))
+               {
+                  RecvQueueChanges(Brief, ChangeData, Changes);
+               }
+
+               mpd_response_finish(connection_);
+            }
+         }
+
          CheckError();
 
          if (status != NULL)
@@ -2370,14 +4774,9 @@ void Client::UpdateStatus(bool ExpectUpdate)
             unsigned int version     = mpd_status_get_queue_version(currentStatus_);
             unsigned int qVersion    = static_cast<uint32_t>(queueVersion_);
             bool const   wasUpdating = updating_;
+            unsigned const updateId  = mpd_status_get_update_id(currentStatus_);
 
-            if (static_cast<int32_t>(volume_) != mpd_status_get_volume(currentStatus_))
-            {
-               volume_ = mpd_status_get_volume(currentStatus_);
-
-               EventData Data; Data.value = volume_;
-               Main::Vimpc::CreateEvent(Event::Volume, Data);
-            }
+            MixerStatus(currentStatus_);
 
             if (updating_ != (mpd_status_get_update_id(currentStatus_) >= 1))
             {
@@ -2390,25 +4789,7 @@ void Client::UpdateStatus(bool ExpectUpdate)
                }
             }
 
-            if (random_ != mpd_status_get_random(currentStatus_))
-            {
-               SetStateAndEvent(Event::Random, random_, mpd_status_get_random(currentStatus_));
-            }
-
-            if (repeat_ != mpd_status_get_repeat(currentStatus_))
-            {
-               SetStateAndEvent(Event::Repeat, repeat_, mpd_status_get_repeat(currentStatus_));
-            }
-
-            if (single_ != mpd_status_get_single(currentStatus_))
-            {
-               SetStateAndEvent(Event::Single, single_, mpd_status_get_single(currentStatus_));
-            }
-
-            if (consume_ != mpd_status_get_consume(currentStatus_))
-            {
-               SetStateAndEvent(Event::Consume, consume_, mpd_status_get_consume(currentStatus_));
-            }
+            OptionsStatus(currentStatus_);
 
             if (totalNumberOfSongs_ != mpd_status_get_queue_length(currentStatus_))
             {
@@ -2418,27 +4799,14 @@ void Client::UpdateStatus(bool ExpectUpdate)
                Main::Vimpc::CreateEvent(Event::TotalSongCount, Data);
             }
 
-            if (crossfade_ != (mpd_status_get_crossfade(currentStatus_) > 0))
-            {
-               crossfade_ = (mpd_status_get_crossfade(currentStatus_) > 0);
-               EventData Data; Data.state = crossfade_;
-               Main::Vimpc::CreateEvent(Event::Crossfade, Data);
-            }
-
-            if (crossfade_ == true)
-            {
-               if (crossfadeTime_ != mpd_status_get_crossfade(currentStatus_))
-               {
-                  crossfadeTime_ = mpd_status_get_crossfade(currentStatus_);
-                  EventData Data; Data.value = crossfadeTime_;
-                  Main::Vimpc::CreateEvent(Event::CrossfadeTime, Data);
-               }
-            }
+            int const  SongId      = (currentSong_ != NULL) ? static_cast<int>(mpd_song_get_id(currentSong_)) : -1;
+            bool const SongChanged = (mpd_status_get_song_id(currentStatus_) != SongId);
 
             // Check if we need to update the current song
             if ((mpdstate_ != mpd_status_get_state(currentStatus_)) ||
                ((mpdstate_ != MPD_STATE_STOP) && (currentSong_ == NULL)) ||
                ((mpdstate_ == MPD_STATE_STOP) && (currentSong_ != NULL)) ||
+               ((mpdstate_ != MPD_STATE_STOP) && (SongChanged == true)) ||
                ((currentSong_ != NULL) &&
                 (mpd_song_get_duration(currentSong_) > 0) &&
                 ((elapsed_ >= mpd_song_get_duration(currentSong_) - 3) ||
@@ -2446,7 +4814,29 @@ void Client::UpdateStatus(bool ExpectUpdate)
                   (mpd_status_get_elapsed_time(currentStatus_) <= 3))))
             {
                autoscroll_ = true;
-               UpdateCurrentSong();
+
+               if (FetchSong == true)
+               {
+                  SetCurrentSong(fetchedSong);
+                  fetchedSong = NULL;
+               }
+               else if ((SongChanged == false) && (currentSong_ != NULL) &&
+                        (mpd_status_get_state(currentStatus_) != MPD_STATE_STOP) &&
+                        (ChangeData.Payload().posuri.empty() == true) && (Changes.empty() == true))
+               {
+                  // Same song so the one we already have is still correct
+                  CurrentSongEvents();
+               }
+               else
+               {
+                  UpdateCurrentSong();
+               }
+            }
+
+            if (fetchedSong != NULL)
+            {
+               mpd_song_free(fetchedSong);
+               fetchedSong = NULL;
             }
 
             mpdstate_   = mpd_status_get_state(currentStatus_);
@@ -2479,18 +4869,34 @@ void Client::UpdateStatus(bool ExpectUpdate)
 
             if ((queueVersion_ > -1) && (version > qVersion) && (queueUpdate_ == false))
             {
-               oldVersion_  = queueVersion_;
-               queueUpdate_ = true;
+               oldVersion_ = queueVersion_;
+
+               if (FetchChanges == true)
+               {
+                  // The changes came back with the status
+                  ResolveQueueChanges(oldVersion_, Changes, ChangeData);
+                  ChangeData.count = totalNumberOfSongs_;
+                  QueueChangesReceived(version, ChangeData);
+
+                  if ((mpdstate_ != MPD_STATE_STOP) && (currentSongId_ != mpd_status_get_song_pos(currentStatus_)))
+                  {
+                     currentSongId_ = mpd_status_get_song_pos(currentStatus_);
+                     EventData IdData; IdData.id = currentSongId_;
+                     Main::Vimpc::CreateEvent(Event::CurrentSongId, IdData);
+                  }
+               }
+               else
+               {
+                  queueUpdate_ = true;
+               }
             }
 
-            if ((wasUpdating == true) && (updating_ == false))
+            // Job ids increase, so a later job running means the last one sent has finished
+            if (((wasUpdating == true) && (updating_ == false)) ||
+                ((updateJob_ != 0) && (updateId > updateJob_)))
             {
-               GetAllMetaInformation();
-               UpdateCurrentSong();
-
-               EventData Data;
-               Main::Vimpc::CreateEvent(Event::UpdateComplete, Data);
-               Main::Vimpc::CreateEvent(Event::Repaint,   Data);
+               updateJob_ = 0;
+               SyncDatabase();
             }
 
             queueVersion_ = version;
@@ -2528,68 +4934,246 @@ void Client::QueueMetaChanges()
 
    if (Connected() == true)
    {
-      struct mpd_status * status = mpd_run_status(connection_);
+      struct mpd_status * status = NULL;
+      struct mpd_song   * song   = NULL;
+      EventData           Data;
+      QueueChanges        Changes;
+      bool                Brief  = false;
+
+      // Everything needed is requested in one go, if the queue has not
+      // actually changed the changes are simply empty
+      Debug("Client::List queue meta data changes since %d", oldVersion_);
+
+      if (mpd_command_list_begin(connection_, true) == true)
+      {
+         mpd_send_status(connection_);
+         Brief = SendQueueChanges(oldVersion_);
+         mpd_send_current_song(connection_);
+
+         if (mpd_command_list_end(connection_) == true)
+         {
+            status = mpd_recv_status(connection_);
+
+            if ((status != NULL) && (mpd_response_next(connection_) == true))
+            {
+               RecvQueueChanges(Brief, Data, Changes);
+
+               if (mpd_response_next(connection_) == true)
+               {
+                  song = mpd_recv_song(connection_);
+               }
+            }
+
+            mpd_response_finish(connection_);
+         }
+      }
+
+      CheckError();
+
+      if (status == NULL)
+      {
+         queueUpdate_ = false;
+         return;
+      }
+
       queueVersion_ = mpd_status_get_queue_version(status);
 
       if (totalNumberOfSongs_ != mpd_status_get_queue_length(status))
       {
          totalNumberOfSongs_ = mpd_status_get_queue_length(status);
 
-         EventData Data; Data.count = totalNumberOfSongs_;
-         Main::Vimpc::CreateEvent(Event::TotalSongCount, Data);
+         EventData CountData; CountData.count = totalNumberOfSongs_;
+         Main::Vimpc::CreateEvent(Event::TotalSongCount, CountData);
       }
 
+      mpd_status_free(status);
+
       if (oldVersion_ != queueVersion_)
       {
-         Debug("Client::List queue meta data changes %d %d", oldVersion_, queueVersion_);
-         mpd_send_queue_changes_meta(connection_, oldVersion_);
-
-         mpd_song * nextSong = mpd_recv_song(connection_);
-         EventData Data;
-         Data.count = totalNumberOfSongs_;
+         Debug("Client::Queue meta data changes %d %d", oldVersion_, queueVersion_);
 
-         for (; nextSong != NULL; nextSong = mpd_recv_song(connection_))
+         if ((Queue.Empty() == true) && (InteractiveEmpty() == true))
          {
-            Song * newSong = NULL;
+            ResolveQueueChanges(oldVersion_, Changes, Data);
+            Data.count = totalNumberOfSongs_;
+            QueueChangesReceived(queueVersion_, Data);
+            SetCurrentSong(song);
+            song = NULL;
+         }
+      }
+      else
+      {
+         queueUpdate_ = false;
+      }
 
-            if (((settings_.Get(Setting::ListAllMeta) == false) &&
-                 (Main::Library().Song(Data.uri) == NULL)) ||
-                // Handle "virtual" songs embedded within files
-                (mpd_song_get_end(nextSong) != 0))
-            {
-               newSong = CreateSong(nextSong);
-            }
+      if (song != NULL)
+      {
+         mpd_song_free(song);
+      }
+   }
+}
 
-            //Debug("Change: %d %s", mpd_song_get_pos(nextSong), mpd_song_get_uri(nextSong));
-            Data.posuri.push_back(std::make_pair(mpd_song_get_pos(nextSong), std::make_pair(newSong, mpd_song_get_uri(nextSong))));
-            mpd_song_free(nextSong);
-         }
+bool Client::SendQueueChanges(int version)
+{
+   // Without the library the songs have to be created from the changes
+   bool const Brief = (settings_.Get(Setting::ListAllMeta) == true);
+
+   if (Brief == true)
+   {
+      mpd_send_queue_changes_brief(connection_, version);
+   }
+   else
+   {
+      mpd_send_queue_changes_meta(connection_, version);
+   }
 
-         QueueMutex.lock();
+   return Brief;
+}
 
-         if (Queue.size() == 0)
-         {
-            QueueMutex.unlock();
+void Client::RecvQueueChanges(bool brief, EventData & Data, QueueChanges & changes)
+{
+   if (brief == true)
+   {
+      unsigned position = 0;
+      unsigned id       = 0;
+
+      while (mpd_recv_queue_change_brief(connection_, &position, &id) == true)
+      {
+         changes.push_back(std::make_pair(position, id));
+      }
+   }
+   else
+   {
+      mpd_song * nextSong = mpd_recv_song(connection_);
+
+      for (; nextSong != NULL; nextSong = mpd_recv_song(connection_))
+      {
+         //Debug("Change: %d %s", mpd_song_get_pos(nextSong), mpd_song_get_uri(nextSong));
+         Data.Payload().posuri.push_back(std::make_pair(mpd_song_get_pos(nextSong), QueueSong(nextSong)));
+         mpd_song_free(nextSong);
+      }
+   }
+}
+
+void Client::ResolveQueueChanges(int version, QueueChanges const & changes, EventData & Data)
+{
+   std::vector<size_t> Missing;
 
-            oldVersion_  = queueVersion_;
-            queueUpdate_ = false;
-            Main::Vimpc::CreateEvent(Event::PlaylistQueueReplace, Data);
+   for (auto change : changes)
+   {
+      std::map<uint32_t, std::string>::const_iterator const it = queueIds_.find(change.second);
+
+      if (it == queueIds_.end())
+      {
+         Missing.push_back(Data.Payload().posuri.size());
+      }
+
+      std::string const URI = (it != queueIds_.end()) ? it->second : "";
+      Data.Payload().posuri.push_back(std::make_pair(change.first, std::make_pair(static_cast<Mpc::Song *>(NULL), URI)));
+   }
+
+   bool Resolved = true;
+
+   // Songs that were added since the ids were last seen are looked up by id
+   for (size_t i = 0; ((i < Missing.size()) && (Resolved == true)); i += QueueLookupBatchSize)
+   {
+      size_t const End = std::min(Missing.size(), i + QueueLookupBatchSize);
+
+      Debug("Client::Look up %d queue ids", static_cast<int>(End - i));
+
+      Resolved = ((Connected() == true) && (mpd_command_list_begin(connection_, true) == true));
+
+      for (size_t j = i; ((j < End) && (Resolved == true)); ++j)
+      {
+         Resolved = mpd_send_get_queue_song_id(connection_, changes[Missing[j]].second);
+      }
 
-            EventData QueueData;
-            Main::Vimpc::CreateEvent(Event::QueueUpdate, QueueData);
+      Resolved = ((Resolved == true) && (mpd_command_list_end(connection_) == true));
+
+      for (size_t j = i; ((j < End) && (Resolved == true)); ++j)
+      {
+         mpd_song * const song = mpd_recv_song(connection_);
 
-            UpdateCurrentSong();
+         if (song != NULL)
+         {
+            Data.Payload().posuri[Missing[j]].second = QueueSong(song);
+            mpd_song_free(song);
          }
-         else
+
+         Resolved = ((song != NULL) && ((j + 1 == End) || (mpd_response_next(connection_) == true)));
+      }
+
+      if (Connected() == true)
+      {
+         mpd_response_finish(connection_);
+
+         // The song may have been removed since the changes were listed
+         if (mpd_connection_get_error(connection_) == MPD_ERROR_SERVER)
          {
-            QueueMutex.unlock();
+            mpd_connection_clear_error(connection_);
          }
+
+         CheckError();
       }
-      else
+   }
+
+   if (Resolved == false)
+   {
+      Debug("Client::Queue ids could not be resolved, listing changes with tags");
+
+      for (auto change : Data.Payload().posuri)
       {
-         queueUpdate_ = false;
+         delete change.second.first;
       }
+
+      Data.Payload().posuri.clear();
+
+      if ((Connected() == true) && (mpd_send_queue_changes_meta(connection_, version) == true))
+      {
+         QueueChanges Unused;
+         RecvQueueChanges(false, Data, Unused);
+      }
+
+      ClearCommand();
+   }
+}
+
+std::pair<Mpc::Song *, std::string> Client::QueueSong(mpd_song const * song)
+{
+   std::string const URI     = mpd_song_get_uri(song);
+   Mpc::Song *       newSong = NULL;
+
+   if (mpd_song_get_end(song) == 0)
+   {
+      queueIds_[mpd_song_get_id(song)] = URI;
+   }
+
+   if (((settings_.Get(Setting::ListAllMeta) == false) &&
+        (Main::Library().Song(URI) == NULL)) ||
+       // Handle "virtual" songs embedded within files
+       (mpd_song_get_end(song) != 0))
+   {
+      newSong = CreateSong(song);
+   }
+
+   return std::make_pair(newSong, URI);
+}
+
+void Client::QueueChangesReceived(int version, EventData const & Data)
+{
+   oldVersion_  = version;
+   queueUpdate_ = false;
+
+   // Ids of songs that have been removed are never looked up again,
+   // forget them all once they greatly outnumber the queue
+   if (queueIds_.size() > 2 * totalNumberOfSongs_ + QueueLookupBatchSize)
+   {
+      queueIds_.clear();
    }
+   Main::Vimpc::CreateEvent(Event::PlaylistQueueReplace, Data);
+
+   EventData QueueData;
+   Main::Vimpc::CreateEvent(Event::QueueUpdate, QueueData);
 }
 
 
@@ -2607,6 +5191,14 @@ void Client::GetVersion()
          versionMinor_ = version[1];
          versionPatch_ = version[2];
 
+         // Filter expressions were added in mpd 0.21
+#if LIBMPDCLIENT_CHECK_VERSION(2,15,0)
+         filters_ = ((versionMajor_ > 0) || (versionMinor_ >= 21));
+
+         // The contains operator was added in mpd 0.24
+         contains_ = ((versionMajor_ > 0) || (versionMinor_ >= 24));
+#endif
+
          Debug("libmpdclient: %d.%d.%d", LIBMPDCLIENT_MAJOR_VERSION, LIBMPDCLIENT_MINOR_VERSION, LIBMPDCLIENT_PATCH_VERSION);
          Debug("MPD Server  : %d.%d.%d", versionMajor_, versionMinor_, versionPatch_);
       }
@@ -2637,12 +5229,22 @@ bool Client::CheckError()
          if (ClearError == false)
          {
             Debug("Client::Unable to clear error");
+
+            bool const WasReady = ready_;
+
+            // Remember where the queue was so only what changed needs listing
+            if (WasReady == true)
+            {
+               resyncVersion_ = queueVersion_;
+            }
+
             DeleteConnection();
 
-            if ((settings_.Get(Setting::Reconnect) == true) && (retried_ == false))
+            if ((settings_.Get(Setting::Reconnect) == true) &&
+                ((WasReady == true) || (reconnectDelay_ > 0)))
             {
-               retried_ = true;
-               Connect(hostname_, port_);
+               resync_ = (resync_ == true) || (WasReady == true);
+               ScheduleReconnect();
             }
          }
          else
@@ -2673,11 +5275,19 @@ void Client::DeleteConnection()
    state_        = MPD_STATE_UNKNOWN;
 
    totalNumberOfSongs_ = 0;
+   updatePaths_.clear();
+   pendingUpdates_.clear();
+   pendingRescan_ = false;
+   timeToUpdate_  = -1;
+   updateJob_     = 0;
 
    versionMajor_ = -1;
    versionMinor_ = -1;
    versionPatch_ = -1;
+   filters_      = false;
+   contains_     = false;
    queueVersion_ = -1;
+   queueIds_.clear();
 
    StateEvent();
 
@@ -2686,6 +5296,8 @@ void Client::DeleteConnection()
    // to different hosts, etc, figure this out
    //Queue.clear();
 
+   CloseIdleConnection();
+
    if (connection_ != NULL)
    {
       mpd_connection_free(connection_);
@@ -23,8 +23,12 @@
 
 
 #include <mpd/client.h>
+#include <sys/socket.h>
+#include <sys/time.h>
 
+#include "commandqueue.hpp"
 #include "compiler.hpp"
+#include "librarycache.hpp"
 #include "output.hpp"
 #include "screen.hpp"
 #include "buffers.hpp"
@@ -55,6 +59,8 @@
 #define LIBMPDCLIENT_PATCH_VERSION 0
 #endif
 
+struct EventData;
+
 namespace Main
 {
    class Settings;
@@ -71,11 +77,76 @@ namespace Mpc
 {
    class Client;
    class Output;
+   class ResponseParser;
    class Song;
 
    uint32_t SecondsToMinutes(uint32_t duration);
    uint32_t RemainingSeconds(uint32_t duration);
 
+   //! The fewest paths whose update covers all of the given paths, files in the
+   //! same directory become that directory and more than maxPaths become their
+   //! common ancestor, unless that is the root in which case they are all kept
+   std::vector<std::string> UpdateRoots(std::vector<std::string> const & paths, size_t maxPaths);
+
+   struct ResolvedAddress
+   {
+      int                     family;
+      int                     socktype;
+      int                     protocol;
+      socklen_t               length;
+      struct sockaddr_storage address;
+   };
+
+   //! A connection to an mpd server that has not yet been established
+   class PendingConnection
+   {
+      public:
+         typedef enum
+         {
+            Resolving,
+            Connecting,
+            Welcome
+         } State;
+
+      public:
+         PendingConnection(std::string const & hostname, uint16_t port, uint32_t timeout_ms, std::string const & password);
+         ~PendingConnection();
+
+      private:
+         PendingConnection(PendingConnection & connection);
+         PendingConnection & operator=(PendingConnection & connection);
+
+      public:
+         //! Returns true if the addresses are immediately available
+         bool StartResolve();
+         bool Resolved();
+         void ForgetAddresses();
+         bool TimedOut() const;
+         long TimeLeft() const;
+
+         //! Starts a non-blocking connect to the next address, false if there are none left
+         bool ConnectNextAddress();
+
+         //! These return 1 when complete, 0 when still in progress and -1 on failure
+         int  WaitForConnect(uint32_t timeout_ms);
+         int  ReadWelcome(uint32_t timeout_ms);
+
+         void CloseSocket();
+
+      public:
+         State                        state_;
+         std::string                  hostname_;
+         uint16_t                     port_;
+         uint32_t                     timeout_;
+         std::string                  password_;
+         std::string                  key_;
+         std::vector<ResolvedAddress> addresses_;
+         size_t                       next_;
+         int                          fd_;
+         std::string                  welcome_;
+         struct timeval               start_;
+   };
+
    class CommandList
    {
       public:
@@ -96,7 +167,23 @@ namespace Mpc
       ~Client();
 
    public:
-      void QueueCommand(FUNCTION<void()> const & function);
+      //! Interactive commands are run in order with the normal commands
+      //! queued before them, but may run between the chunks of a bulk
+      //! add that is already in progress
+      typedef enum
+      {
+         Normal,
+         Interactive
+      } Priority;
+
+      //! The returned handle is signalled once the command has been run
+      CompletionHandle QueueCommand(FUNCTION<void()> const & function, Priority priority = Normal);
+
+      //! For commands that only send a request, consecutive ones are sent
+      //! to mpd together in a command list
+      CompletionHandle QueueBatchableCommand(FUNCTION<void()> const & function);
+
+      //! Blocks until every command queued so far has been run
       void WaitForCompletion();
 
    private:
@@ -111,6 +198,20 @@ namespace Mpc
       void Reconnect();
       void Password(std::string const & password);
 
+   private:
+      // Connection establishment, each step is queued as a separate command
+      void ConnectStep(uint32_t connectId);
+      void ConnectComplete();
+      void ConnectFailed(std::string const & reason);
+      void CancelConnect();
+
+      // Connections that drop are reconnected with an increasing delay and
+      // then resynchronised rather than listing everything again
+      void ScheduleReconnect();
+      void CancelReconnect();
+      bool Resync();
+      bool ServerStats(uint64_t & dbUpdate, time_t & started, uint32_t & songs);
+
    public:
       // Playback functions
       void Play(uint32_t playId);
@@ -195,9 +296,24 @@ namespace Mpc
       void SearchAlbum(std::string const & search, bool exact = false);
       void SearchGenre(std::string const & search, bool exact = false);
       void SearchSong(std::string const & search, bool exact = false);
+
+      //! Search with an mpd filter expression, only if SupportsFilters
+      void SearchExpression(std::string const & expression);
+      bool SupportsFilters() const { return filters_; }
+      bool SupportsContains() const { return contains_; }
       void AddAllSearchResults();
       void SearchResults(std::string const & name);
 
+      //! Request the page of results following offset for the search with this id,
+      //! servers that cannot page searches send every result with the first page
+      void SearchMore(uint32_t id, uint32_t offset);
+
+   private:
+      void Search(mpd_tag_type tag, std::string const & search, bool exact);
+      void BeginSearch();
+      bool SearchPaged() const;
+      void SearchPage(uint32_t count);
+
    public:
       // Database state
       void Rescan(std::string const & Path);
@@ -205,22 +321,94 @@ namespace Mpc
       void StartCommandList();
       void SendCommandList();
       void UpdateCurrentSong();
+      void SetCurrentSong(struct mpd_song * song);
+      void CurrentSongEvents();
       void UpdateStatus(bool ExpectUpdate = false);
       void QueueMetaChanges();
 
+   private:
+      // Only refresh whatever the idle events say has changed
+      void IdleEvents(int mask);
+      void UpdateMixer();
+      void UpdateOptions();
+      void UpdateQueue();
+      void UpdateDatabase();
+      void UpdateStoredPlaylists();
+      void UpdateOutputs();
+      void MixerStatus(struct mpd_status * status);
+      void OptionsStatus(struct mpd_status * status);
+      void SyncDatabase();
+
+      //! Updates and rescans are held back briefly so that a burst of them,
+      //! such as editing each song of an album, is sent as one batch
+      void ScheduleUpdate(std::string const & Path, bool rescan);
+      void SendUpdates();
+
+   private:
+      // Positions and ids of songs that changed in the queue
+      typedef std::vector<std::pair<uint32_t, uint32_t> > QueueChanges;
+
+      //! Only positions and ids are requested when the songs can be found
+      //! in the library, the uris are filled in by ResolveQueueChanges
+      bool SendQueueChanges(int version);
+      void RecvQueueChanges(bool brief, EventData & Data, QueueChanges & changes);
+      void ResolveQueueChanges(int version, QueueChanges const & changes, EventData & Data);
+      void QueueChangesReceived(int version, EventData const & Data);
+      std::pair<Mpc::Song *, std::string> QueueSong(mpd_song const * song);
+
    public:
       void GetAllOutputs();
       void GetAllMetaInformation();
       void GetAllMetaFromRoot();
 
+      //! Fetch the tags for songs that were listed without them. If asked to
+      //! notify and any are still to arrive, the returned id is sent with a
+      //! TagsApplied event once the SongTags event before it has been handled
+      uint32_t FetchTags(std::vector<Mpc::Song *> const & songs, bool notify = false);
+
+   private:
+      //! Lists the paths that were given to Update or Rescan again rather than the whole database
+      void GetUpdatedMetaInformation();
+
+      //! Finds the directories of songs modified since the last sync, for changes made by other clients
+      bool ModifiedPaths(std::vector<std::string> & paths);
+
+      //! Lists each top level directory on its own connection
+      bool ParallelListAll(uint32_t connections, std::vector<Mpc::Song *> & songs,
+                           std::vector<std::string> & paths, ListFiles & lists);
+      void AddEntity(mpd_entity const * entity, std::vector<Mpc::Song *> & songs,
+                     std::vector<std::string> & paths, ListFiles & lists) const;
+
+      //! A server error is reported like any other, otherwise the
+      //! connection is out of step with libmpdclient and is dropped
+      void NativeParserFailed(Mpc::ResponseParser const & parser);
+
+      //! Songs are sent to the buffers in batches rather than as an event each
+      void DatabaseSongEvents(std::vector<Mpc::Song *> const & songs);
+
+      std::vector<std::string> TagRequests(std::vector<Mpc::Song *> const & songs) const;
+      void ListTags(std::vector<std::string> const & uris, std::vector<Mpc::Song *> & songs,
+                    std::vector<std::string> & unanswered);
+
    private:
       bool Connected() const;
       void IncrementTime(long time);
       void StateEvent();
       void CheckForEvents();
+      void CheckForIdleEvents();
+      void OpenIdleConnection();
+      void IdleConnectStep(uint32_t connectId);
+      void IdleConnectComplete();
+      void CloseIdleConnection();
       void IdleMode();
       void ExitIdleMode();
       void ClientQueueExecutor(Mpc::Client * client);
+      bool RunInteractiveCommands();
+      bool ResolveSteps();
+      void RunBatch(FUNCTION<void()> const & function, CompletionHandle const & completion);
+      void AddURIs(std::vector<std::string> const & URIs);
+      void WaitForActivity(int timeout_ms);
+      int  NextTimeout() const;
       void SetStateAndEvent(int, bool & state, bool value);
 
    private:
@@ -248,8 +436,16 @@ namespace Mpc
       uint32_t                versionMajor_;
       uint32_t                versionMinor_;
       uint32_t                versionPatch_;
+      Atomic(bool)            filters_;
+      Atomic(bool)            contains_;
       long                    timeSinceUpdate_;
-      bool                    retried_;
+      long                    reconnectDelay_;
+      long                    timeToReconnect_;
+      bool                    resync_;
+      int                     resyncVersion_;
+      uint64_t                dbUpdate_;
+      uint32_t                dbSongs_;
+      time_t                  serverStarted_;
       bool                    ready_;
 
       uint32_t                volume_;
@@ -278,13 +474,43 @@ namespace Mpc
       std::string             loadedList_;
 
       Ui::Screen &            screen_;
+      uint32_t                connectId_;
+      PendingConnection *     pending_;
+      uint32_t                connectTimeout_;
+      std::string             password_;
+
+      // Optional second connection that is only used to wait for idle events,
+      // established in steps in the same way as the command connection
+      uint32_t                idleConnectId_;
+      PendingConnection *     idlePending_;
+      struct mpd_connection * idleConnection_;
+      int                     idleFd_;
+      long                    timeSinceCommand_;
       int                     queueVersion_;
       int                     oldVersion_;
+      // Uri of each song id in the queue that is not a virtual song
+      std::map<uint32_t, std::string> queueIds_;
       bool                    forceUpdate_;
       bool                    listMode_;
       bool                    idleMode_;
       bool                    queueUpdate_;
       bool                    autoscroll_;
+      std::vector<std::string> updatePaths_;
+      std::vector<std::string> pendingUpdates_;
+      bool                    pendingRescan_;
+      long                    timeToUpdate_;
+      unsigned                updateJob_;
+
+      // Last search sent, kept so that further pages of its results can be requested
+      mpd_tag_type            searchTag_;
+      std::string             searchTerm_;
+      std::string             searchExpression_;
+      std::string             searchName_;
+      bool                    searchExact_;
+      uint32_t                searchId_;
+      uint32_t                searchOffset_;
+      Atomic(bool)            searchPending_;
+      uint32_t                tagRequest_;
       Thread                  clientThread_;
 
       bool                    error_;
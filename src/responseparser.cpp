@@ -0,0 +1,343 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   responseparser.cpp - reads song lists straight from the mpd socket
+   */
+
+#include "responseparser.hpp"
+
+#include "song.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Mpc;
+
+// Large enough that the whole of a big listallinfo arrives in few reads
+static size_t const BufferSize       = 256 * 1024;
+static int    const SocketBufferSize = 1024 * 1024;
+
+namespace
+{
+   struct TagName
+   {
+      char const *      name;
+      size_t            length;
+      enum mpd_tag_type tag;
+   };
+
+   // Only the first value of each tag is used, as with mpd_song_get_tag(song, tag, 0)
+   TagName const Tags[] =
+   {
+      { "Artist",      6,  MPD_TAG_ARTIST },
+      { "AlbumArtist", 11, MPD_TAG_ALBUM_ARTIST },
+      { "Album",       5,  MPD_TAG_ALBUM },
+      { "Title",       5,  MPD_TAG_TITLE },
+      { "Track",       5,  MPD_TAG_TRACK },
+      { "Genre",       5,  MPD_TAG_GENRE },
+      { "Date",        4,  MPD_TAG_DATE },
+      { "Disc",        4,  MPD_TAG_DISC },
+   };
+
+   // Position of Title in Tags, a song without one is given the unknown title
+   uint32_t const TitleTag = 3;
+
+   bool KeyIs(char const * key, size_t length, char const * name, size_t nameLength)
+   {
+      return ((length == nameLength) && (memcmp(key, name, length) == 0));
+   }
+}
+
+
+ResponseParser::ResponseParser(int fd, uint32_t timeout_ms) :
+   fd_               (fd),
+   timeout_          ((timeout_ms > 0) ? timeout_ms : 30 * 1000),
+   buffer_           (BufferSize),
+   start_            (0),
+   end_              (0),
+   song_             (NULL),
+   position_         (-1),
+   id_               (-1),
+   tags_             (0),
+   duration_         (false),
+   done_             (false),
+   serverError_      (false)
+{
+   int size = SocketBufferSize;
+   setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+ResponseParser::~ResponseParser()
+{
+   delete song_;
+}
+
+
+bool ResponseParser::Send(std::string const & command)
+{
+   std::string const Line = command + "\n";
+   size_t            sent = 0;
+
+   while (sent < Line.size())
+   {
+      ssize_t const Result = write(fd_, Line.c_str() + sent, Line.size() - sent);
+
+      if (Result > 0)
+      {
+         sent += Result;
+      }
+      else if ((Result < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+      {
+         pollfd fds = { fd_, POLLOUT, 0 };
+
+         if (poll(&fds, 1, timeout_) <= 0)
+         {
+            error_ = "Timeout sending command";
+            return false;
+         }
+      }
+      else
+      {
+         error_ = strerror(errno);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool ResponseParser::Receive(SongFunction const & song, PathFunction const & directory,
+                             PathFunction const & playlist)
+{
+   songFunction_      = song;
+   directoryFunction_ = directory;
+   playlistFunction_  = playlist;
+   done_              = false;
+
+   while (done_ == false)
+   {
+      char * const Line = static_cast<char *>(memchr(&buffer_[start_], '\n', end_ - start_));
+
+      if (Line == NULL)
+      {
+         if (Fill() == false)
+         {
+            return false;
+         }
+      }
+      else
+      {
+         size_t const Length = Line - &buffer_[start_];
+         ParseLine(&buffer_[start_], Length);
+         start_ += Length + 1;
+      }
+   }
+
+   return (serverError_ == false);
+}
+
+std::string const & ResponseParser::Error() const
+{
+   return error_;
+}
+
+bool ResponseParser::ServerError() const
+{
+   return serverError_;
+}
+
+
+bool ResponseParser::Fill()
+{
+   // Move the partial line to the front, only growing the buffer
+   // if a single line does not fit in it
+   if (start_ > 0)
+   {
+      memmove(&buffer_[0], &buffer_[start_], end_ - start_);
+      end_  -= start_;
+      start_ = 0;
+   }
+
+   if (end_ == buffer_.size())
+   {
+      buffer_.resize(buffer_.size() * 2);
+   }
+
+   while (true)
+   {
+      ssize_t const Result = read(fd_, &buffer_[end_], buffer_.size() - end_);
+
+      if (Result > 0)
+      {
+         end_ += Result;
+         return true;
+      }
+      else if (Result == 0)
+      {
+         error_ = "Connection closed";
+         return false;
+      }
+      else if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+      {
+         pollfd fds = { fd_, POLLIN, 0 };
+
+         if (poll(&fds, 1, timeout_) <= 0)
+         {
+            error_ = "Timeout receiving response";
+            return false;
+         }
+      }
+      else
+      {
+         error_ = strerror(errno);
+         return false;
+      }
+   }
+}
+
+void ResponseParser::ParseLine(char * line, size_t length)
+{
+   if (KeyIs(line, length, "OK", 2) == true)
+   {
+      FinishEntity();
+      done_ = true;
+      return;
+   }
+   else if ((length >= 4) && (memcmp(line, "ACK ", 4) == 0))
+   {
+      FinishEntity();
+      error_.assign(line, length);
+      serverError_ = true;
+      done_        = true;
+      return;
+   }
+
+   char const * const Separator = static_cast<char const *>(memchr(line, ':', length));
+
+   if ((Separator == NULL) || (static_cast<size_t>(Separator - line) + 2 > length))
+   {
+      return;
+   }
+
+   size_t       const KeyLength   = Separator - line;
+   char       * const Value       = line + KeyLength + 2;
+   size_t       const ValueLength = length - KeyLength - 2;
+
+   if (KeyIs(line, KeyLength, "file", 4) == true)
+   {
+      FinishEntity();
+
+      if (song_ == NULL)
+      {
+         song_ = new Mpc::Song();
+      }
+
+      // Terminate the value in place rather than copying it
+      Value[ValueLength] = '\0';
+      song_->SetURI(Value);
+   }
+   else if (KeyIs(line, KeyLength, "directory", 9) == true)
+   {
+      FinishEntity();
+      directoryFunction_(Value, ValueLength);
+   }
+   else if (KeyIs(line, KeyLength, "playlist", 8) == true)
+   {
+      FinishEntity();
+      playlistFunction_(Value, ValueLength);
+   }
+   else if ((song_ != NULL) && (song_->URI() != ""))
+   {
+      Value[ValueLength] = '\0';
+
+      // Like mpd_song_get_duration prefer Time, using duration only without it
+      if (KeyIs(line, KeyLength, "Time", 4) == true)
+      {
+         song_->SetDuration(atoi(Value));
+         duration_ = true;
+      }
+      else if (KeyIs(line, KeyLength, "duration", 8) == true)
+      {
+         if (duration_ == false)
+         {
+            song_->SetDuration(static_cast<int32_t>(strtod(Value, NULL) + 0.5));
+         }
+      }
+      else if (KeyIs(line, KeyLength, "Range", 5) == true)
+      {
+         char const * const End = strchr(Value, '-');
+
+         if ((End != NULL) && (End[1] != '\0'))
+         {
+            song_->SetVirtualEnd(static_cast<int32_t>(strtod(End + 1, NULL)));
+         }
+      }
+      else if (KeyIs(line, KeyLength, "Pos", 3) == true)
+      {
+         position_ = atoi(Value);
+      }
+      else if (KeyIs(line, KeyLength, "Id", 2) == true)
+      {
+         id_ = atoi(Value);
+      }
+      else
+      {
+         for (uint32_t i = 0; i < sizeof(Tags) / sizeof(Tags[0]); ++i)
+         {
+            if ((KeyIs(line, KeyLength, Tags[i].name, Tags[i].length) == true) &&
+                ((tags_ & (1 << i)) == 0))
+            {
+               tags_ |= (1 << i);
+               value_.assign(Value, ValueLength);
+               song_->SetTag(Tags[i].tag, value_);
+               break;
+            }
+         }
+      }
+   }
+}
+
+void ResponseParser::FinishEntity()
+{
+   if ((song_ != NULL) && (song_->URI() != ""))
+   {
+      if ((tags_ & (1 << TitleTag)) == 0)
+      {
+         song_->SetTitle(NULL);
+      }
+
+      if (songFunction_(song_, position_, id_) == true)
+      {
+         song_ = NULL;
+      }
+      else
+      {
+         *song_ = Mpc::Song();
+      }
+   }
+
+   position_ = -1;
+   id_       = -1;
+   tags_     = 0;
+   duration_ = false;
+}
+
+/* vim: set sw=3 ts=3: */
@@ -0,0 +1,96 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   responseparser.hpp - reads song lists straight from the mpd socket
+   */
+
+#ifndef __MPC__RESPONSEPARSER
+#define __MPC__RESPONSEPARSER
+
+#include "compiler.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Mpc
+{
+   class Song;
+
+   //! Parses the responses to listallinfo and playlistinfo without going
+   //! through libmpdclient, tags are interned directly from the receive
+   //! buffer and a song is only allocated when the caller keeps it.
+   //!
+   //! The command is written to the socket directly, so this must only be
+   //! used when libmpdclient is not waiting for a response on it.
+   class ResponseParser
+   {
+   public:
+      //! Return true to take ownership of the song, otherwise it is reused,
+      //! position and id are -1 unless the song is in the queue
+      typedef FUNCTION<bool (Mpc::Song * song, int32_t position, int32_t id)> SongFunction;
+      typedef FUNCTION<void (char const * path, size_t length)>   PathFunction;
+
+      ResponseParser(int fd, uint32_t timeout_ms);
+      ~ResponseParser();
+
+   private:
+      ResponseParser(ResponseParser const & parser);
+      ResponseParser & operator=(ResponseParser const & parser);
+
+   public:
+      bool Send(std::string const & command);
+
+      //! Returns false if mpd responded with an error or the connection
+      //! failed, in which case Error() says which
+      bool Receive(SongFunction const & song, PathFunction const & directory,
+                   PathFunction const & playlist);
+
+      std::string const & Error() const;
+      bool ServerError() const;
+
+   private:
+      bool Fill();
+      void ParseLine(char * line, size_t length);
+      void FinishEntity();
+
+   private:
+      int               fd_;
+      uint32_t          timeout_;
+      std::vector<char> buffer_;
+      size_t            start_;
+      size_t            end_;
+
+      SongFunction      songFunction_;
+      PathFunction      directoryFunction_;
+      PathFunction      playlistFunction_;
+
+      Mpc::Song *       song_;
+      int32_t           position_;
+      int32_t           id_;
+      uint32_t          tags_;
+      bool              duration_;
+      std::string       value_;
+
+      bool              done_;
+      bool              serverError_;
+      std::string       error_;
+   };
+}
+
+#endif
+/* vim: set sw=3 ts=3: */
@@ -25,6 +25,7 @@
 #endif
 
 #include <csignal>
+#include <fcntl.h>
 #include <list>
 #include <poll.h>
 #include <signal.h>
@@ -52,6 +53,7 @@
 #include "window/listwindow.hpp"
 #include "window/outputwindow.hpp"
 #include "window/playlistwindow.hpp"
+#include "window/serverwindow.hpp"
 #include "window/result.hpp"
 #include "window/songwindow.hpp"
 #include "window/windowselector.hpp"
@@ -80,6 +82,30 @@ int32_t RndCount   = 0;
 static Atomic(bool)   Running(true);
 static RecursiveMutex CursesMutex;
 
+// Written to by the signal handlers and on shutdown so that the input
+// thread can sleep on the terminal without a timeout
+static int            InputWakeupPipe[2] = { -1, -1 };
+
+static void OpenInputWakeupPipe()
+{
+   if (pipe(InputWakeupPipe) == 0)
+   {
+      for (int i = 0; i < 2; ++i)
+      {
+         fcntl(InputWakeupPipe[i], F_SETFD, FD_CLOEXEC);
+         fcntl(InputWakeupPipe[i], F_SETFL, fcntl(InputWakeupPipe[i], F_GETFL) | O_NONBLOCK);
+      }
+   }
+}
+
+static void WakeInput()
+{
+   char const Byte = 0;
+
+   // Only async signal safe calls here, this is used by the signal handlers
+   if (write(InputWakeupPipe[1], &Byte, 1) < 0) { }
+}
+
 extern "C" void ResizeHandler(int);
 extern "C" void ContinueHandler(int);
 
@@ -120,9 +146,11 @@ void QueueInput(WINDOW * inputWindow)
    wtimeout(inputWindow, -1);
    CursesMutex.unlock();
 
-   pollfd fds;
-   fds.fd = 1;
-   fds.events = POLLIN;
+   pollfd fds[2];
+   fds[0].fd     = 1;
+   fds[0].events = POLLIN;
+   fds[1].fd     = InputWakeupPipe[0];
+   fds[1].events = POLLIN;
 
    while (Running == true)
    {
@@ -147,7 +175,30 @@ void QueueInput(WINDOW * inputWindow)
          Main::Vimpc::CreateEvent(Event::Continue, Data);
       }
 
-      if (poll(&fds, 1, 250) <= 0)
+      fds[0].revents = 0;
+      fds[1].revents = 0;
+
+      if (poll(fds, (InputWakeupPipe[0] != -1) ? 2 : 1, (InputWakeupPipe[0] != -1) ? -1 : 250) <= 0)
+      {
+         continue;
+      }
+
+      if ((fds[1].revents & POLLIN) != 0)
+      {
+         char Buffer[64];
+         while (read(InputWakeupPipe[0], Buffer, sizeof(Buffer)) > 0) { }
+
+         // The main loop only looks at the window size when it is woken
+         if (WindowResized == true)
+         {
+            EventData Data;
+            Main::Vimpc::CreateEvent(Event::Repaint, Data);
+         }
+
+         continue;
+      }
+
+      if ((fds[0].revents & POLLIN) == 0)
       {
          continue;
       }
@@ -253,6 +304,7 @@ Screen::Screen(Main::Settings & settings, Mpc::Client & client, Mpc::ClientState
    mainWindows_[TestConsole]  = new Ui::ConsoleWindow  (settings, *this, "test",    Main::TestConsole());
    mainWindows_[Console]      = new Ui::ConsoleWindow  (settings, *this, "console", Main::Console());
    mainWindows_[Outputs]      = new Ui::OutputWindow   (settings, *this, Main::Outputs(),   client, search);
+   mainWindows_[Servers]      = new Ui::ServerWindow   (settings, *this, Main::Servers(),   client, search);
    mainWindows_[Library]      = new Ui::LibraryWindow  (settings, *this, Main::Library(),   client, clientState, search);
    mainWindows_[Browse]       = new Ui::BrowseWindow   (settings, *this, Main::Browse(),    client, clientState, search);
    mainWindows_[Directory]    = new Ui::DirectoryWindow(settings, *this, Main::Directory(), client, clientState, search);
@@ -317,28 +369,43 @@ Screen::Screen(Main::Settings & settings, Mpc::Client & client, Mpc::ClientState
    // Song window events
    Main::Vimpc::EventHandler(Event::SearchResults, [this] (EventData const & Data)
    {
-      Ui::SongWindow * const window = CreateSongWindow(Data.name);
+      // Later pages are appended to the window, unless it has since been closed
+      Ui::SongWindow * const window = (Data.pos1 == 0) ? CreateSongWindow(Data.name) : SearchResultsWindow(Data.id);
 
-      for (auto uri : Data.uris)
+      if (window != NULL)
       {
-         Mpc::Song * song = Main::Library().Song(uri);
+         for (auto uri : Data.Payload().uris)
+         {
+            Mpc::Song * song = Main::Library().Song(uri);
 
-         if (song != NULL)
+            if (song != NULL)
+            {
+               window->Buffer().Add(song);
+            }
+         }
+
+         window->SetSearch(Data.id, Data.count, Data.state);
+
+         if (Data.pos1 == 0)
          {
-            window->Buffer().Add(song);
+            // Paged results keep the order mpd sorted them in so pages can be
+            // appended without moving the rows already on screen
+            if (Data.state == false)
+            {
+               Ui::SongSorter const sorter(settings_.Get(::Setting::Sort));
+               window->Buffer().Sort(sorter);
+            }
+
+            SetActiveAndVisible(GetWindowFromName(window->Name()));
          }
       }
-
-      Ui::SongSorter const sorter(settings_.Get(::Setting::Sort));
-      window->Buffer().Sort(sorter);
-      SetActiveAndVisible(GetWindowFromName(window->Name()));
    });
 
    Main::Vimpc::EventHandler(Event::PlaylistContents, [this] (EventData const & Data)
    {
       Ui::SongWindow * const window = CreateSongWindow("P:" + Data.name);
 
-      for (auto uri : Data.uris)
+      for (auto uri : Data.Payload().uris)
       {
          Mpc::Song * song = Main::Library().Song(uri);
 
@@ -365,12 +432,14 @@ Screen::Screen(Main::Settings & settings, Mpc::Client & client, Mpc::ClientState
    });
 
    // Thread handling of input
+   OpenInputWakeupPipe();
    inputThread_ = Thread(QueueInput, commandWindow_);
 }
 
 Screen::~Screen()
 {
    Running = false;
+   WakeInput();
    inputThread_.join();
 
    CursesMutex.lock();
@@ -495,6 +564,21 @@ Ui::SongWindow * Screen::CreateSongWindow(std::string const & name)
    return window;
 }
 
+Ui::SongWindow * Screen::SearchResultsWindow(uint32_t id)
+{
+   for (auto it : mainWindows_)
+   {
+      Ui::SongWindow * const window = dynamic_cast<Ui::SongWindow *>(it.second);
+
+      if ((window != NULL) && (window->SearchId() == id))
+      {
+         return window;
+      }
+   }
+
+   return NULL;
+}
+
 Ui::InfoWindow * Screen::CreateInfoWindow(int32_t Id, std::string const & name, Mpc::Song * song)
 {
    SetVisible(Id, false);
@@ -851,6 +935,10 @@ void Screen::Update()
          UpdateProgressWindow();
       }
 
+      // Songs listed without tags need them before they can be printed
+      (void) ActiveWindow().FetchTags(ActiveWindow().FirstLine(), MaxRows(), false);
+      ActiveWindow().FetchMore(ActiveWindow().FirstLine(), MaxRows());
+
       CursesMutex.lock();
 
       // Paint the main window
@@ -1665,6 +1753,7 @@ void Screen::OnMouseSettingChange(bool Value)
 void ResizeHandler(int i)
 {
    WindowResized = true;
+   WakeInput();
 }
 
 void ContinueHandler(int i)
@@ -1674,5 +1763,6 @@ void ContinueHandler(int i)
    CursesMutex.unlock();
    Continue = true;
    WindowResized = true;
+   WakeInput();
 }
 /* vim: set sw=3 ts=3: */
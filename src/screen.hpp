@@ -106,6 +106,7 @@ namespace Ui
          TestConsole,
          Console,
          Outputs,
+         Servers,
          Library,
          Lists,
          Browse,
@@ -158,6 +159,7 @@ namespace Ui
 
       // Create a new song window, usually used for search results
       Ui::SongWindow * CreateSongWindow(std::string const & name);
+      Ui::SongWindow * SearchResultsWindow(uint32_t id);
       Ui::InfoWindow * CreateInfoWindow(int32_t Id, std::string const & name, Mpc::Song * song = NULL);
       void CreateSongInfoWindow(Mpc::Song * song = NULL);
 
@@ -0,0 +1,319 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   server.cpp - watches the status of another mpd instance
+   */
+
+#include "server.hpp"
+
+#include "events.hpp"
+#include "mpdclient.hpp"
+#include "vimpc.hpp"
+
+#include <mpd/client.h>
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+
+using namespace Mpc;
+
+// Only changes to what is shown in the status are waited for
+static enum mpd_idle const IdleMask = static_cast<enum mpd_idle>(MPD_IDLE_PLAYER | MPD_IDLE_MIXER | MPD_IDLE_OPTIONS);
+
+static unsigned const ConnectTimeoutMs = 5 * 1000;
+
+// How often a thread that is waiting checks whether it should stop
+static int const StopCheckMs = 250;
+
+// How often a name that is being resolved is checked for
+static long const ResolveCheckMs = 25;
+
+// Connecting is retried after this long, doubling each failed attempt
+static long const RetryMinMs = 1000;
+static long const RetryMaxMs = 60 * 1000;
+
+Server::Server(std::string const & hostname, uint16_t port) :
+   hostname_ (hostname),
+   port_     (port),
+   status_   ("Connecting"),
+   running_  (true),
+   thread_   (Thread(&Server::Monitor, this))
+{
+}
+
+Server::~Server()
+{
+   {
+      UniqueLock<Mutex> Lock(mutex_);
+      running_ = false;
+      condition_.notify_all();
+   }
+
+   thread_.join();
+}
+
+
+std::string const & Server::Hostname() const
+{
+   return hostname_;
+}
+
+uint16_t Server::Port() const
+{
+   return port_;
+}
+
+std::string Server::Status() const
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   return status_;
+}
+
+std::string Server::PrintString(bool active) const
+{
+   char port[16];
+   snprintf(port, sizeof(port), "%u", (port_ != 0) ? port_ : 6600);
+
+   return "$H[" + std::string(active ? "$I*$D" : " ") + "] $H" + hostname_ + ":" + port + "  " + Status();
+}
+
+
+void Server::Monitor()
+{
+   long delay = 0;
+
+   while ((delay == 0) || (Sleep(delay) == true))
+   {
+      struct mpd_connection * const connection = Connect();
+
+      if ((connection != NULL) && (mpd_connection_get_error(connection) == MPD_ERROR_SUCCESS))
+      {
+         delay = 0;
+
+         while ((Refresh(connection) == true) &&
+                (mpd_send_idle_mask(connection, IdleMask) == true) &&
+                (WaitForIdle(connection) == true))
+         {
+         }
+      }
+
+      if (connection != NULL)
+      {
+         mpd_connection_free(connection);
+      }
+
+      if (Running() == false)
+      {
+         break;
+      }
+
+      SetStatus("Disconnected");
+      delay = (delay == 0) ? RetryMinMs : std::min(RetryMaxMs, delay * 2);
+   }
+}
+
+struct mpd_connection * Server::Connect()
+{
+   // Connect in steps so that removing the server never waits for a
+   // slow or dead host, only for the current step
+   PendingConnection Pending(hostname_, port_, ConnectTimeoutMs, "");
+
+   if (Pending.StartResolve() == true)
+   {
+      Pending.state_ = PendingConnection::Connecting;
+   }
+
+   while ((Running() == true) && (Pending.TimedOut() == false))
+   {
+      if (Pending.state_ == PendingConnection::Resolving)
+      {
+         if (Pending.Resolved() == false)
+         {
+            Sleep(ResolveCheckMs);
+         }
+         else if (Pending.addresses_.empty() == true)
+         {
+            return NULL;
+         }
+         else
+         {
+            Pending.state_ = PendingConnection::Connecting;
+         }
+      }
+      else if (Pending.state_ == PendingConnection::Connecting)
+      {
+         if ((Pending.fd_ == -1) && (Pending.ConnectNextAddress() == false))
+         {
+            return NULL;
+         }
+
+         int const Result = Pending.WaitForConnect(StopCheckMs);
+
+         if (Result < 0)
+         {
+            Pending.CloseSocket();
+         }
+         else if (Result > 0)
+         {
+            Pending.state_ = PendingConnection::Welcome;
+         }
+      }
+      else
+      {
+         int const Result = Pending.ReadWelcome(StopCheckMs);
+
+         if (Result < 0)
+         {
+            Pending.CloseSocket();
+            Pending.state_ = PendingConnection::Connecting;
+         }
+         else if (Result > 0)
+         {
+            // Ownership of the socket is passed to libmpdclient here
+            struct mpd_async * const async = mpd_async_new(Pending.fd_);
+            Pending.fd_ = -1;
+
+            struct mpd_connection * const connection =
+               (async != NULL) ? mpd_connection_new_async(async, Pending.welcome_.c_str()) : NULL;
+
+            if (connection != NULL)
+            {
+               mpd_connection_set_timeout(connection, ConnectTimeoutMs);
+            }
+
+            return connection;
+         }
+      }
+   }
+
+   return NULL;
+}
+
+bool Server::Refresh(struct mpd_connection * connection)
+{
+   struct mpd_status * const status = mpd_run_status(connection);
+
+   if (status == NULL)
+   {
+      return false;
+   }
+
+   std::string Status;
+
+   switch (mpd_status_get_state(status))
+   {
+      case MPD_STATE_PLAY:  Status = "Playing"; break;
+      case MPD_STATE_PAUSE: Status = "Paused";  break;
+      default:              Status = "Stopped"; break;
+   }
+
+   if (mpd_status_get_state(status) != MPD_STATE_STOP)
+   {
+      struct mpd_song * const song = mpd_run_current_song(connection);
+
+      if (song != NULL)
+      {
+         char const * const artist = mpd_song_get_tag(song, MPD_TAG_ARTIST, 0);
+         char const * const title  = mpd_song_get_tag(song, MPD_TAG_TITLE, 0);
+
+         if ((artist != NULL) && (title != NULL))
+         {
+            Status += std::string("  ") + artist + " - " + title;
+         }
+         else
+         {
+            Status += std::string("  ") + mpd_song_get_uri(song);
+         }
+
+         mpd_song_free(song);
+      }
+   }
+
+   if (mpd_status_get_volume(status) >= 0)
+   {
+      char volume[32];
+      snprintf(volume, sizeof(volume), "  [%d%%]", mpd_status_get_volume(status));
+      Status += volume;
+   }
+
+   mpd_status_free(status);
+
+   SetStatus(Status);
+   return (mpd_connection_get_error(connection) == MPD_ERROR_SUCCESS);
+}
+
+bool Server::WaitForIdle(struct mpd_connection * connection)
+{
+   pollfd fds = { mpd_connection_get_fd(connection), POLLIN, 0 };
+
+   while (true)
+   {
+      if (Running() == false)
+      {
+         return false;
+      }
+
+      int const Result = poll(&fds, 1, StopCheckMs);
+
+      if (Result > 0)
+      {
+         return (mpd_recv_idle(connection, false) != 0);
+      }
+      else if ((Result < 0) && (errno != EINTR))
+      {
+         return false;
+      }
+   }
+}
+
+bool Server::Sleep(long ms)
+{
+   UniqueLock<Mutex> Lock(mutex_);
+
+   if (running_ == true)
+   {
+      ConditionWait(condition_, Lock, static_cast<int>(ms));
+   }
+
+   return running_;
+}
+
+bool Server::Running() const
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   return running_;
+}
+
+void Server::SetStatus(std::string const & status)
+{
+   bool Changed = false;
+
+   {
+      UniqueLock<Mutex> Lock(mutex_);
+      Changed = (status_ != status);
+      status_ = status;
+   }
+
+   if (Changed == true)
+   {
+      EventData Data;
+      Main::Vimpc::CreateEvent(Event::Repaint, Data);
+   }
+}
+
+/* vim: set sw=3 ts=3: */
@@ -0,0 +1,76 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   server.hpp - watches the status of another mpd instance
+   */
+
+#ifndef __MPC_SERVER
+#define __MPC_SERVER
+
+#include "compiler.hpp"
+
+#include <stdint.h>
+#include <string>
+
+struct mpd_connection;
+
+namespace Mpc
+{
+   //! Keeps its own connection open to an mpd instance, waiting in idle on
+   //! a separate thread, so that the state of every server can be shown
+   //! without switching the client over to it. Only the status is watched,
+   //! switching to a server connects the client and loads it in full.
+   class Server
+   {
+   public:
+      Server(std::string const & hostname, uint16_t port);
+      ~Server();
+
+   private:
+      Server(Server const & server);
+      Server & operator=(Server const & server);
+
+   public:
+      std::string const & Hostname() const;
+      uint16_t Port() const;
+
+      std::string Status() const;
+      std::string PrintString(bool active) const;
+
+   private:
+      void Monitor();
+      struct mpd_connection * Connect();
+      bool Refresh(struct mpd_connection * connection);
+      bool WaitForIdle(struct mpd_connection * connection);
+      bool Sleep(long ms);
+      bool Running() const;
+      void SetStatus(std::string const & status);
+
+   private:
+      std::string const hostname_;
+      uint16_t    const port_;
+
+      mutable Mutex     mutex_;
+      ConditionVariable condition_;
+      std::string       status_;
+      bool              running_;
+      Thread            thread_;
+   };
+}
+
+#endif
+/* vim: set sw=3 ts=3: */
@@ -42,14 +42,18 @@
    X(ColourEnabled,    "colour",          true)  /* Determine if we should use colours */ \
    X(ExpandArtists,    "expand-artists",  false) /* Expand artists in the library window by default */ \
    X(HighlightSearch,  "hlsearch",        true)  /* Show search results in a different colour */ \
+   X(IdleConnection,   "idleconnection",  false) /* Use a separate connection to wait for mpd events */ \
    X(IgnoreTheGroup,   "groupignorethe",  false) /* Ignore 'the' when grouping the same artist into library */ \
    X(IgnoreCaseSearch, "ignorecase",      false) /* Turn off case sensitivity on searching */ \
    X(IgnoreCaseSort,   "sortignorecase",  true)  /* Turn off case sensitivity on sorting */\
    X(IgnoreTheSort,    "sortignorethe",   false) /* Ignore 'the' when sorting */ \
    X(SortAlbumDate,    "sortalbumdate",   false) /* Sort albums in the library by date */ \
    X(IncrementalSearch,"incsearch",       false) /* Search for results whilst typing */ \
+   X(LazyTags,         "lazytags",        false) /* Only list song paths at startup, fetch tags when songs are shown */ \
+   X(LibraryCache,     "librarycache",    true)  /* Keep a copy of the database on disk between runs */ \
    X(ListAllMeta,      "listallmeta",     true)  /* Get all meta data */ \
    X(Mouse,            "mouse",           true)  /* Handle mouse keys */ \
+   X(NativeParser,     "nativeparser",    false) /* Parse the library and playlist responses directly from the socket */ \
    X(Polling,          "polling",         false) /* Poll for status updates */ \
    X(PlaylistNumbers,  "playlistnumbers", true)  /* Show id next to each song in the playlist */ \
    X(PlayOnAdd,        "playonadd",       false) /* If mpd is stopped play after first add */ \
@@ -79,8 +83,14 @@
    X(AlbumFormat,      "albumformat", "%B",  ".*") \
    /* Library format string */ \
    X(ArtistFormat,     "artistformat", "%A",  ".*") \
+   /* Milliseconds to wait for more commands to add to a batch */ \
+   X(BatchLatency,     "batchlatency", "2", "\\d+") \
+   /* Most commands to send in one batch, 0 or 1 to disable */ \
+   X(BatchSize,        "batchsize", "256", "\\d+") \
    /* Library format string */ \
    X(LibraryFormat,    "libraryformat", "$I%n \\| $D$H[$H%l$H]$H {%t}|{%f}$E$R ", ".*") \
+   /* Connections used to download the library */ \
+   X(LoadConnections,  "loadconnections", "1", "\\d+") \
    /* Library format string */ \
    X(LocalMusicDir,    "local-music-dir", "", ".*") \
    /* Lyrics strip regex */ \
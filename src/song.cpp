@@ -70,6 +70,7 @@ Song::Song() :
    virtualEnd_  (0),
    uri_         (""),
    title_       (""),
+   tags_        (TagsLoaded),
    lastFormat_  (""),
    formatted_   (""),
    entry_       (NULL)
@@ -87,6 +88,7 @@ Song::Song(Song const & song) :
    duration_    (song.duration_),
    uri_         (song.URI()),
    title_       (song.Title()),
+   tags_        (song.tags_),
    lastFormat_  (song.lastFormat_),
    formatted_   (song.formatted_)
 {
@@ -104,6 +106,23 @@ Song::~Song()
 }
 
 
+void Song::CopyTags(Song const & song)
+{
+   artist_      = song.artist_;
+   albumArtist_ = song.albumArtist_;
+   album_       = song.album_;
+   track_       = song.track_;
+   genre_       = song.genre_;
+   date_        = song.date_;
+   disc_        = song.disc_;
+   duration_    = song.duration_;
+   virtualEnd_  = song.virtualEnd_;
+   title_       = song.title_;
+   tags_        = song.tags_;
+   lastFormat_  = "";
+}
+
+
 int32_t Song::Reference() const
 {
    return reference_;
@@ -182,6 +201,66 @@ void Song::Set(const char * newVal, int32_t & oldVal, std::vector<std::string> &
    }
 }
 
+void Song::Set(std::string const & newVal, int32_t & oldVal, std::vector<std::string> & Values, std::map<std::string, uint32_t> & Indexes)
+{
+   lastFormat_ = "";
+
+   auto it = Indexes.find(newVal);
+
+   if (it == Indexes.end())
+   {
+      oldVal = Values.size();
+      Indexes[newVal] = oldVal;
+      Values.push_back(newVal);
+   }
+   else
+   {
+      oldVal = it->second;
+   }
+}
+
+void Song::SetTag(enum mpd_tag_type tag, std::string const & value)
+{
+   switch (tag)
+   {
+      case MPD_TAG_ARTIST:
+         Set(value, artist_, Artists, ArtistMap);
+         break;
+
+      case MPD_TAG_ALBUM_ARTIST:
+         Set(value, albumArtist_, Artists, ArtistMap);
+         break;
+
+      case MPD_TAG_ALBUM:
+         Set(value, album_, Albums, AlbumMap);
+         break;
+
+      case MPD_TAG_TITLE:
+         lastFormat_ = "";
+         title_      = value;
+         break;
+
+      case MPD_TAG_TRACK:
+         Set(value, track_, Tracks, TrackMap);
+         break;
+
+      case MPD_TAG_GENRE:
+         Set(value, genre_, Genres, GenreMap);
+         break;
+
+      case MPD_TAG_DATE:
+         Set(value, date_, Dates, DateMap);
+         break;
+
+      case MPD_TAG_DISC:
+         Set(value, disc_, Discs, DiscMap);
+         break;
+
+      default:
+         break;
+   }
+}
+
 void Song::SetArtist(const char * artist)
 {
    Set(artist, artist_, Artists, ArtistMap);
@@ -396,6 +475,112 @@ LibraryEntry * Song::Entry() const
    return entry_;
 }
 
+void Song::SetTagState(TagState state)
+{
+   tags_ = state;
+}
+
+Song::TagState Song::Tags() const
+{
+   return tags_;
+}
+
+// Tags are written as a length followed by the characters, a length of -1
+// is used for tags that are not set so that they are restored as unknown
+static void WriteString(std::ostream & stream, std::string const * value)
+{
+   int32_t const Length = (value != NULL) ? static_cast<int32_t>(value->size()) : -1;
+
+   stream.write(reinterpret_cast<char const *>(&Length), sizeof(Length));
+
+   if (Length > 0)
+   {
+      stream.write(value->data(), Length);
+   }
+}
+
+// No tag is anywhere near this long, a larger length means the cache is corrupt
+static int32_t const MaxStringLength = 64 * 1024;
+
+static bool ReadString(std::istream & stream, std::string & value, bool & valid)
+{
+   int32_t Length = -1;
+
+   if ((stream.read(reinterpret_cast<char *>(&Length), sizeof(Length))) &&
+       (Length >= -1) && (Length <= MaxStringLength))
+   {
+      valid = (Length >= 0);
+      value.resize((Length > 0) ? Length : 0);
+
+      if ((Length <= 0) || (stream.read(&value[0], Length)))
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static std::string const * Tag(int32_t index, std::vector<std::string> const & Values)
+{
+   return ((index >= 0) && (index < static_cast<int32_t>(Values.size()))) ? &Values.at(index) : NULL;
+}
+
+void Song::Serialise(std::ostream & stream) const
+{
+   WriteString(stream, &uri_);
+   WriteString(stream, &title_);
+   WriteString(stream, Tag(artist_,      Artists));
+   WriteString(stream, Tag(albumArtist_, Artists));
+   WriteString(stream, Tag(album_,       Albums));
+   WriteString(stream, Tag(track_,       Tracks));
+   WriteString(stream, Tag(genre_,       Genres));
+   WriteString(stream, Tag(date_,        Dates));
+   WriteString(stream, Tag(disc_,        Discs));
+
+   stream.write(reinterpret_cast<char const *>(&duration_),   sizeof(duration_));
+   stream.write(reinterpret_cast<char const *>(&virtualEnd_), sizeof(virtualEnd_));
+}
+
+bool Song::Deserialise(std::istream & stream)
+{
+   typedef void (Mpc::Song::*SetFunction)(const char *);
+
+   static SetFunction const Setters[] =
+   {
+      &Mpc::Song::SetURI,         &Mpc::Song::SetTitle,
+      &Mpc::Song::SetArtist,      &Mpc::Song::SetAlbumArtist,
+      &Mpc::Song::SetAlbum,       &Mpc::Song::SetTrack,
+      &Mpc::Song::SetGenre,       &Mpc::Song::SetDate,
+      &Mpc::Song::SetDisc
+   };
+
+   std::string Value;
+   bool        Valid = false;
+
+   for (auto Setter : Setters)
+   {
+      if (ReadString(stream, Value, Valid) == false)
+      {
+         return false;
+      }
+
+      (this->*Setter)((Valid == true) ? Value.c_str() : NULL);
+   }
+
+   int32_t Duration = 0, End = 0;
+
+   if ((stream.read(reinterpret_cast<char *>(&Duration), sizeof(Duration))) &&
+       (stream.read(reinterpret_cast<char *>(&End), sizeof(End))))
+   {
+      SetDuration(Duration);
+      SetVirtualEnd(End);
+      return true;
+   }
+
+   return false;
+}
+
 std::string const & Song::DurationString() const
 {
    static std::string Result;
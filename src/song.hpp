@@ -22,6 +22,7 @@
 #define __MPC_SONG
 
 #include <stdint.h>
+#include <iostream>
 #include <string>
 #include <mpd/song.h>
 
@@ -57,6 +58,14 @@ namespace Mpc
          All
       } SongCollection;
 
+      // Songs listed lazily only know their URI until their tags are fetched
+      typedef enum
+      {
+         TagsLoaded,
+         TagsMissing,
+         TagsRequested
+      } TagState;
+
    public:
       // When we equate songs we can just check if they refer
       // to the same file in the database, if they do, they are the same
@@ -135,9 +144,23 @@ namespace Mpc
       void SetEntry(LibraryEntry * entry);
       LibraryEntry * Entry() const;
 
+      void SetTagState(TagState state);
+      TagState Tags() const;
+
       std::string FormatString(std::string fmt) const;
       std::string ParseString(std::string::const_iterator &it, bool valid) const;
 
+      // Take the tags from another song, used when a song is modified in the database
+      void CopyTags(Song const & song);
+
+      // Set a tag from a value that is reused between calls, unlike the setters
+      // above this does not need to create a temporary string for the lookup
+      void SetTag(enum mpd_tag_type tag, std::string const & value);
+
+      // Binary representation used for the on disk library cache
+      void Serialise(std::ostream & stream) const;
+      bool Deserialise(std::istream & stream);
+
    public:
       typedef std::string const & (Mpc::Song::*SongFunction)() const;
       static std::map<char, SongFunction> SongInfo;
@@ -164,6 +187,7 @@ namespace Mpc
 
    private:
       void Set(const char * newVal, int32_t & oldVal, std::vector<std::string> & Values, std::map<std::string, uint32_t> & Indexes);
+      void Set(std::string const & newVal, int32_t & oldVal, std::vector<std::string> & Values, std::map<std::string, uint32_t> & Indexes);
 
    private:
       int32_t     reference_;
@@ -178,6 +202,7 @@ namespace Mpc
       int32_t     virtualEnd_;
       std::string uri_;
       std::string title_;
+      TagState    tags_;
 
       mutable std::string lastFormat_;
       mutable std::string formatted_;
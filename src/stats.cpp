@@ -0,0 +1,249 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   stats.cpp - counts and timings of events, mpd commands and painting
+   */
+
+#include "stats.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace Main;
+
+long const Stats::BucketLimit[Stats::BucketCount - 1] = { 100, 1000, 4000, 16000, 64000, 256000 };
+
+static char const * const BucketName[Stats::BucketCount] =
+   { "<100us", "<1ms", "<4ms", "<16ms", "<64ms", "<256ms", ">=256ms" };
+
+static std::string Number(uint64_t value)
+{
+   char buffer[32];
+   snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+   return buffer;
+}
+
+static std::string Quote(std::string const & value)
+{
+   std::string result = "\"";
+
+   for (auto c : value)
+   {
+      if ((c == '"') || (c == '\\'))
+      {
+         result += '\\';
+      }
+
+      result += c;
+   }
+
+   return result + "\"";
+}
+
+
+Stats & Stats::Instance()
+{
+   static Stats stats;
+   return stats;
+}
+
+Stats::Stats()
+{
+}
+
+Stats::~Stats()
+{
+}
+
+long Stats::Elapsed(Chrono::steady_clock::time_point const & start)
+{
+   return Chrono::duration_cast<Chrono::microseconds>(Chrono::steady_clock::now() - start).count();
+}
+
+
+void Stats::AddEvent(std::string const & name, long microseconds)
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   events_[name].Add(microseconds);
+}
+
+void Stats::AddTiming(std::string const & name, long microseconds)
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   timings_[name].Add(microseconds);
+}
+
+void Stats::QueueDepth(std::string const & name, uint32_t depth)
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   uint32_t & highest = queues_[name];
+
+   if (depth > highest)
+   {
+      highest = depth;
+   }
+}
+
+void Stats::Reset()
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   events_.clear();
+   timings_.clear();
+   queues_.clear();
+}
+
+
+std::vector<std::string> Stats::Lines() const
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   std::vector<std::string> lines;
+
+
+   lines.push_back("Events:");
+   AddLines(lines, events_);
+   lines.push_back("");
+
+   lines.push_back("Timings:");
+   AddLines(lines, timings_);
+   lines.push_back("");
+
+   lines.push_back("Queue high water:");
+
+   for (auto queue : queues_)
+   {
+      lines.push_back("   " + queue.first + " " + Number(queue.second));
+   }
+
+   return lines;
+}
+
+void Stats::AddLines(std::vector<std::string> & lines, TimingTable const & table)
+{
+   char buffer[128];
+   snprintf(buffer, sizeof(buffer), "   %-24s %8s %9s %8s ", "", "count", "mean(us)", "max(us)");
+
+   std::string header(buffer);
+
+   for (uint32_t i = 0; i < BucketCount; ++i)
+   {
+      header += " " + std::string(BucketName[i]);
+   }
+
+   lines.push_back(header);
+
+   for (auto entry : table)
+   {
+      Timing const & timing = entry.second;
+
+      snprintf(buffer, sizeof(buffer), "   %-24s %8llu %9llu %8ld ", entry.first.c_str(),
+               static_cast<unsigned long long>(timing.count_),
+               static_cast<unsigned long long>(timing.total_ / timing.count_), timing.max_);
+
+      std::string line(buffer);
+
+      for (uint32_t i = 0; i < BucketCount; ++i)
+      {
+         snprintf(buffer, sizeof(buffer), " %*llu", static_cast<int>(strlen(BucketName[i])),
+                  static_cast<unsigned long long>(timing.buckets_[i]));
+         line += buffer;
+      }
+
+      lines.push_back(line);
+   }
+}
+
+
+std::string Stats::Json() const
+{
+   UniqueLock<Mutex> Lock(mutex_);
+   std::string json = "{\"buckets\":[";
+
+   for (uint32_t i = 0; i < BucketCount; ++i)
+   {
+      json += ((i > 0) ? "," : "") + Quote(BucketName[i]);
+   }
+
+   json += "],\"events\":" + Json(events_) + ",\"timings\":" + Json(timings_) + ",\"queues\":{";
+
+   bool first = true;
+
+   for (auto queue : queues_)
+   {
+      json += ((first == true) ? "" : ",") + Quote(queue.first) + ":" + Number(queue.second);
+      first = false;
+   }
+
+   return json + "}}";
+}
+
+std::string Stats::Json(TimingTable const & table)
+{
+   std::string json = "{";
+   bool first = true;
+
+   for (auto entry : table)
+   {
+      Timing const & timing = entry.second;
+
+      json += ((first == true) ? "" : ",") + Quote(entry.first) +
+              ":{\"count\":" + Number(timing.count_) +
+              ",\"total_us\":" + Number(timing.total_) +
+              ",\"max_us\":" + Number(timing.max_) + ",\"histogram\":[";
+
+      for (uint32_t i = 0; i < BucketCount; ++i)
+      {
+         json += ((i > 0) ? "," : "") + Number(timing.buckets_[i]);
+      }
+
+      json += "]}";
+      first = false;
+   }
+
+   return json + "}";
+}
+
+
+Stats::Timing::Timing() :
+   count_(0),
+   total_(0),
+   max_  (0)
+{
+   for (uint32_t i = 0; i < BucketCount; ++i)
+   {
+      buckets_[i] = 0;
+   }
+}
+
+void Stats::Timing::Add(long microseconds)
+{
+   uint32_t bucket = 0;
+
+   while ((bucket < BucketCount - 1) && (microseconds >= BucketLimit[bucket]))
+   {
+      ++bucket;
+   }
+
+   ++count_;
+   ++buckets_[bucket];
+   total_ += microseconds;
+
+   if (microseconds > max_)
+   {
+      max_ = microseconds;
+   }
+}
+/* vim: set sw=3 ts=3: */
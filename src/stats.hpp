@@ -0,0 +1,97 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   stats.hpp - counts and timings of events, mpd commands and painting
+   */
+
+#ifndef __MAIN__STATS
+#define __MAIN__STATS
+
+#include "compiler.hpp"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Main
+{
+   //! Records how often things happen and how long they take, for :stats
+   class Stats
+   {
+   public:
+      static Stats & Instance();
+
+   public:
+      Stats();
+      ~Stats();
+
+   public:
+      // Upper bound in microseconds of each histogram bucket, the last is unbounded
+      static uint32_t const BucketCount = 7;
+      static long const     BucketLimit[BucketCount - 1];
+
+      //! Microseconds since \p start
+      static long Elapsed(Chrono::steady_clock::time_point const & start);
+
+   public:
+      //! The handlers of the named event took \p microseconds
+      void AddEvent(std::string const & name, long microseconds);
+
+      //! Anything else worth timing, painting or an mpd command
+      void AddTiming(std::string const & name, long microseconds);
+
+      //! Keep the deepest a queue has been
+      void QueueDepth(std::string const & name, uint32_t depth);
+
+      void Reset();
+
+   public:
+      //! Readable summary for the pager
+      std::vector<std::string> Lines() const;
+
+      //! Everything recorded as a json object
+      std::string Json() const;
+
+   private:
+      struct Timing
+      {
+         Timing();
+
+         void Add(long microseconds);
+
+         uint64_t count_;
+         uint64_t total_;
+         long     max_;
+         uint64_t buckets_[BucketCount];
+      };
+
+      typedef std::map<std::string, Timing> TimingTable;
+
+      static void AddLines(std::vector<std::string> & lines, TimingTable const & table);
+      static std::string Json(TimingTable const & table);
+
+   private:
+      TimingTable                     events_;
+      TimingTable                     timings_;
+      std::map<std::string, uint32_t> queues_;
+      mutable Mutex                   mutex_;
+   };
+}
+
+#endif
+/* vim: set sw=3 ts=3: */
@@ -23,10 +23,13 @@
 #include "algorithm.hpp"
 #include "buffers.hpp"
 #include "output.hpp"
+#include "song.hpp"
 #include "test.hpp"
 #include "vimpc.hpp"
 
+#include "buffer/library.hpp"
 #include "buffer/outputs.hpp"
+#include "buffer/playlist.hpp"
 #include "mode/command.hpp"
 #include "window/debug.hpp"
 #include "window/error.hpp"
@@ -42,6 +45,7 @@ class CommandTester : public CppUnit::TestFixture
    CPPUNIT_TEST(SetActiveWindowCommands);
    CPPUNIT_TEST(StateCommands);
    CPPUNIT_TEST(OutputCommands);
+   CPPUNIT_TEST(BatchedAddFailure);
    CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -66,6 +70,7 @@ protected:
    void SetActiveWindowCommands();
    void StateCommands();
    void OutputCommands();
+   void BatchedAddFailure();
 
 private:
    void ActiveWindow(std::string window, Ui::Screen::MainWindow);
@@ -251,6 +256,7 @@ void CommandTester::SetActiveWindowCommands()
    ActiveWindow("directory",    Ui::Screen::Directory);
    ActiveWindow("playlist",     Ui::Screen::Playlist);
    ActiveWindow("outputs",      Ui::Screen::Outputs);
+   ActiveWindow("servers",      Ui::Screen::Servers);
    ActiveWindow("lists",        Ui::Screen::Lists);
    ActiveWindow("windowselect", Ui::Screen::WindowSelect);
 }
@@ -470,5 +476,40 @@ void CommandTester::OutputCommands()
    screen_.SetVisible(Ui::Screen::Outputs, visible);
 }
 
+void CommandTester::BatchedAddFailure()
+{
+   Mpc::Song * song = NULL;
+   Main::Library().ForEachSong([&song] (Mpc::Song * next) { if (song == NULL) { song = next; } });
+   CPPUNIT_ASSERT(song != NULL);
+
+   Mpc::Song missing;
+   missing.SetURI("vimpc/test/this file does not exist.mp3");
+
+   uint32_t const Count = clientState_.TotalNumberOfSongs();
+
+   // These are sent as one command list, which mpd stops at the missing file
+   Ui::ErrorWindow::Instance().ClearError();
+   client_.Add(*song);
+   client_.Add(missing);
+   client_.Add(*song);
+   client_.WaitForCompletion();
+
+   // The playlist is listed again so that it only has what mpd added
+   for (int i = 0; (i < 100) && ((clientState_.TotalNumberOfSongs() != Count + 1) ||
+                                 (Main::Playlist().Size() != Count + 1)); ++i)
+   {
+      Main::Vimpc::WaitForEvent(Event::Repaint, 50);
+   }
+
+   CPPUNIT_ASSERT(Ui::ErrorWindow::Instance().HasError() == true);
+   CPPUNIT_ASSERT(clientState_.TotalNumberOfSongs() == Count + 1);
+   CPPUNIT_ASSERT(Main::Playlist().Size() == Count + 1);
+   CPPUNIT_ASSERT(Main::Playlist().Get(Count)->URI() == song->URI());
+
+   Ui::ErrorWindow::Instance().ClearError();
+   client_.Delete(Count);
+   client_.WaitForCompletion();
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(CommandTester);
 CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(CommandTester, "command");
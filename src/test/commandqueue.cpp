@@ -0,0 +1,186 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   commandqueue.cpp - tests for the client's command queue
+   */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "commandqueue.hpp"
+
+#include <vector>
+
+// More than fit in the ring, so the overflow list is used
+static uint32_t const Commands  = 3000;
+static uint32_t const Producers = 4;
+
+class CommandQueueTester : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(CommandQueueTester);
+   CPPUNIT_TEST(wraparound);
+   CPPUNIT_TEST(overflow);
+   CPPUNIT_TEST(producers);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   CommandQueueTester() { }
+
+public:
+   void setUp();
+   void tearDown();
+
+protected:
+   void wraparound();
+   void overflow();
+   void producers();
+
+private:
+   //! Runs everything that is queued, returns how many were run
+   uint32_t Drain();
+
+private:
+   Mpc::CommandQueue *   queue_;
+   std::vector<uint32_t> run_;
+};
+
+void CommandQueueTester::setUp()
+{
+   queue_ = new Mpc::CommandQueue();
+   run_.clear();
+}
+
+void CommandQueueTester::tearDown()
+{
+   delete queue_;
+   queue_ = NULL;
+}
+
+uint32_t CommandQueueTester::Drain()
+{
+   Mpc::CommandQueue::Command command;
+   Mpc::CompletionHandle      completion;
+   uint32_t                   count = 0;
+
+   while (queue_->Pop(command, completion) == true)
+   {
+      command();
+      completion->Signal();
+      ++count;
+   }
+
+   return count;
+}
+
+void CommandQueueTester::wraparound()
+{
+   // Pushing and popping a few at a time goes round the ring several times
+   for (uint32_t i = 0; i < Commands; i += 10)
+   {
+      for (uint32_t j = i; j < i + 10; ++j)
+      {
+         queue_->Push([this, j] () { run_.push_back(j); });
+      }
+
+      CPPUNIT_ASSERT((Drain() == 10));
+   }
+
+   CPPUNIT_ASSERT((run_.size() == Commands));
+
+   for (uint32_t i = 0; i < run_.size(); ++i)
+   {
+      CPPUNIT_ASSERT((run_[i] == i));
+   }
+
+   CPPUNIT_ASSERT((queue_->Empty() == true));
+   CPPUNIT_ASSERT((queue_->Pushed() == queue_->Popped()));
+}
+
+void CommandQueueTester::overflow()
+{
+   std::vector<Mpc::CompletionHandle> completions;
+
+   for (uint32_t i = 0; i < Commands; ++i)
+   {
+      completions.push_back(queue_->Push([this, i] () { run_.push_back(i); }));
+   }
+
+   CPPUNIT_ASSERT((queue_->Empty() == false));
+   CPPUNIT_ASSERT((queue_->Pushed() == Commands));
+   CPPUNIT_ASSERT((Drain() == Commands));
+   CPPUNIT_ASSERT((queue_->Empty() == true));
+
+   for (uint32_t i = 0; i < Commands; ++i)
+   {
+      CPPUNIT_ASSERT((run_[i] == i));
+      CPPUNIT_ASSERT((completions[i]->Done() == true));
+   }
+
+   // Once drained the ring is used again
+   queue_->Push([this] () { run_.push_back(Commands); });
+   CPPUNIT_ASSERT((Drain() == 1));
+   CPPUNIT_ASSERT((run_.back() == Commands));
+}
+
+void CommandQueueTester::producers()
+{
+   std::vector<Thread *> threads;
+
+   // Each producer's commands record which producer they came from and
+   // their position, the consumer runs them while they are still pushed
+   for (uint32_t p = 0; p < Producers; ++p)
+   {
+      threads.push_back(new Thread([this, p] ()
+      {
+         for (uint32_t i = 0; i < Commands; ++i)
+         {
+            queue_->Push([this, p, i] () { run_.push_back((p * Commands) + i); });
+         }
+      }));
+   }
+
+   while (run_.size() < Producers * Commands)
+   {
+      Drain();
+   }
+
+   for (auto thread : threads)
+   {
+      thread->join();
+      delete thread;
+   }
+
+   CPPUNIT_ASSERT((Drain() == 0));
+   CPPUNIT_ASSERT((run_.size() == Producers * Commands));
+
+   std::vector<uint32_t> next(Producers, 0);
+
+   for (auto value : run_)
+   {
+      uint32_t const Producer = value / Commands;
+
+      CPPUNIT_ASSERT((value % Commands == next[Producer]));
+      next[Producer] = (value % Commands) + 1;
+   }
+
+   for (uint32_t p = 0; p < Producers; ++p)
+   {
+      CPPUNIT_ASSERT((next[p] == Commands));
+   }
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CommandQueueTester);
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(CommandQueueTester, "commandqueue");
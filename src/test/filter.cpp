@@ -0,0 +1,142 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   filter.cpp - tests for compound song queries
+   */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "filter.hpp"
+#include "song.hpp"
+
+class FilterTester : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(FilterTester);
+   CPPUNIT_TEST(comparison);
+   CPPUNIT_TEST(compound);
+   CPPUNIT_TEST(quoting);
+   CPPUNIT_TEST(invalid);
+   CPPUNIT_TEST(contains);
+   CPPUNIT_TEST(matches);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   FilterTester() { }
+
+public:
+   void setUp();
+   void tearDown();
+
+protected:
+   void comparison();
+   void compound();
+   void quoting();
+   void invalid();
+   void contains();
+   void matches();
+
+private:
+   Mpc::Song song_;
+};
+
+void FilterTester::setUp()
+{
+   song_.SetArtist("Foo Fighters");
+   song_.SetAlbum("Live at Wembley");
+   song_.SetGenre("Rock");
+   song_.SetURI("Bar/Best of/Everlong.mp3");
+}
+
+void FilterTester::tearDown()
+{
+}
+
+void FilterTester::comparison()
+{
+   CPPUNIT_ASSERT((Mpc::Filter("artist == Foo").Expression(true) == "(Artist == \"Foo\")"));
+   CPPUNIT_ASSERT((Mpc::Filter("Album contains bar").Expression(true) == "(Album contains \"bar\")"));
+   CPPUNIT_ASSERT((Mpc::Filter("genre=~^Rock").Expression(true) == "(Genre =~ \"^Rock\")"));
+   CPPUNIT_ASSERT((Mpc::Filter("file !~ flac$").Expression(true) == "(file !~ \"flac$\")"));
+}
+
+void FilterTester::compound()
+{
+   CPPUNIT_ASSERT((Mpc::Filter("artist == a and title != b").Expression(true) ==
+                   "((Artist == \"a\") AND (Title != \"b\"))"));
+
+   CPPUNIT_ASSERT((Mpc::Filter("not date == 1999").Expression(true) == "(!(Date == \"1999\"))"));
+
+   // mpd has no or, so it is written with not and and
+   CPPUNIT_ASSERT((Mpc::Filter("artist == a || artist == b").Expression(true) ==
+                   "(!((!(Artist == \"a\")) AND (!(Artist == \"b\"))))"));
+
+   // and binds tighter than or unless there are brackets
+   CPPUNIT_ASSERT((Mpc::Filter("artist == a and (album == b or album == c)").Expression(true) ==
+                   "((Artist == \"a\") AND (!((!(Album == \"b\")) AND (!(Album == \"c\")))))"));
+}
+
+void FilterTester::quoting()
+{
+   CPPUNIT_ASSERT((Mpc::Filter("title == \"and or\"").Expression(true) == "(Title == \"and or\")"));
+   CPPUNIT_ASSERT((Mpc::Filter("title == 'it\\'s'").Expression(true) == "(Title == \"it\\'s\")"));
+   CPPUNIT_ASSERT((Mpc::Filter("title == 'say \"hi\"'").Expression(true) == "(Title == \"say \\\"hi\\\"\")"));
+}
+
+void FilterTester::invalid()
+{
+   CPPUNIT_ASSERT((Mpc::Filter("").Valid() == false));
+   CPPUNIT_ASSERT((Mpc::Filter("artist").Valid() == false));
+   CPPUNIT_ASSERT((Mpc::Filter("colour == red").Valid() == false));
+   CPPUNIT_ASSERT((Mpc::Filter("(artist == a").Valid() == false));
+   CPPUNIT_ASSERT((Mpc::Filter("artist == a b").Valid() == false));
+   CPPUNIT_ASSERT((Mpc::Filter("artist == a and").Valid() == false));
+   CPPUNIT_ASSERT((Mpc::Filter("artist == a").Valid() == true));
+}
+
+void FilterTester::contains()
+{
+   // Before mpd 0.24 contains is sent as a regex with the value escaped
+   CPPUNIT_ASSERT((Mpc::Filter("album contains bar").Expression(false) == "(Album =~ \"bar\")"));
+   CPPUNIT_ASSERT((Mpc::Filter("title contains 'a.b (live)'").Expression(false) == "(Title =~ \"a\\\\.b \\\\(live\\\\)\")"));
+   CPPUNIT_ASSERT((Mpc::Filter("not album contains x").Expression(false) == "(!(Album =~ \"x\"))"));
+}
+
+void FilterTester::matches()
+{
+   // == matches part of the tag, ignoring case, as mpd's search does
+   CPPUNIT_ASSERT((Mpc::Filter("artist == foo").Matches(song_) == true));
+   CPPUNIT_ASSERT((Mpc::Filter("artist == 'foo fighters'").Matches(song_) == true));
+   CPPUNIT_ASSERT((Mpc::Filter("artist == bar").Matches(song_) == false));
+   CPPUNIT_ASSERT((Mpc::Filter("artist != bar").Matches(song_) == true));
+   CPPUNIT_ASSERT((Mpc::Filter("album contains WEMBLEY").Matches(song_) == true));
+
+   // any matches if one of the tags does, and its negation only if none do
+   CPPUNIT_ASSERT((Mpc::Filter("any == rock").Matches(song_) == true));
+   CPPUNIT_ASSERT((Mpc::Filter("any != rock").Matches(song_) == false));
+
+   // The path is only compared by file, any leaves it out as mpd does
+   CPPUNIT_ASSERT((Mpc::Filter("file == bar").Matches(song_) == true));
+   CPPUNIT_ASSERT((Mpc::Filter("any == bar").Matches(song_) == false));
+   CPPUNIT_ASSERT((Mpc::Filter("any != bar").Matches(song_) == true));
+
+   CPPUNIT_ASSERT((Mpc::Filter("artist == foo and not genre == pop").Matches(song_) == true));
+   CPPUNIT_ASSERT((Mpc::Filter("artist == bar or (album == live and genre == rock)").Matches(song_) == true));
+   CPPUNIT_ASSERT((Mpc::Filter("artist == bar or album == studio").Matches(song_) == false));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FilterTester);
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(FilterTester, "filter");
@@ -0,0 +1,87 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   stats.cpp - tests for the event and command timings
+   */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "stats.hpp"
+
+class StatsTester : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(StatsTester);
+   CPPUNIT_TEST(histogram);
+   CPPUNIT_TEST(queueDepth);
+   CPPUNIT_TEST(reset);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   StatsTester() { }
+
+public:
+   void setUp();
+   void tearDown();
+
+protected:
+   void histogram();
+   void queueDepth();
+   void reset();
+
+private:
+};
+
+void StatsTester::setUp()
+{
+}
+
+void StatsTester::tearDown()
+{
+}
+
+void StatsTester::histogram()
+{
+   Main::Stats stats;
+   stats.AddEvent("Repaint", 50);
+   stats.AddEvent("Repaint", 2000);
+   stats.AddEvent("Repaint", 300000);
+
+   CPPUNIT_ASSERT((stats.Json().find("\"Repaint\":{\"count\":3,\"total_us\":302050,\"max_us\":300000,"
+                                     "\"histogram\":[1,0,1,0,0,0,1]}") != std::string::npos));
+}
+
+void StatsTester::queueDepth()
+{
+   Main::Stats stats;
+   stats.QueueDepth("events", 4);
+   stats.QueueDepth("events", 12);
+   stats.QueueDepth("events", 7);
+
+   CPPUNIT_ASSERT((stats.Json().find("\"queues\":{\"events\":12}") != std::string::npos));
+}
+
+void StatsTester::reset()
+{
+   Main::Stats stats;
+   stats.AddTiming("repaint", 10);
+   stats.Reset();
+
+   CPPUNIT_ASSERT((stats.Json().find("repaint") == std::string::npos));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StatsTester);
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(StatsTester, "stats");
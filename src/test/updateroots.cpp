@@ -0,0 +1,114 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   updateroots.cpp - tests for choosing the paths to update
+   */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mpdclient.hpp"
+
+#include <stdio.h>
+
+class UpdateRootsTester : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(UpdateRootsTester);
+   CPPUNIT_TEST(siblings);
+   CPPUNIT_TEST(nesting);
+   CPPUNIT_TEST(root);
+   CPPUNIT_TEST(overflow);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   UpdateRootsTester() { }
+
+public:
+   void setUp();
+   void tearDown();
+
+protected:
+   void siblings();
+   void nesting();
+   void root();
+   void overflow();
+
+private:
+   std::vector<std::string> Roots(std::vector<std::string> const & paths, size_t maxPaths = 16);
+};
+
+void UpdateRootsTester::setUp()
+{
+}
+
+void UpdateRootsTester::tearDown()
+{
+}
+
+std::vector<std::string> UpdateRootsTester::Roots(std::vector<std::string> const & paths, size_t maxPaths)
+{
+   return Mpc::UpdateRoots(paths, maxPaths);
+}
+
+void UpdateRootsTester::siblings()
+{
+   // Files in the same directory become that directory
+   CPPUNIT_ASSERT((Roots({ "a/b/1.mp3", "a/b/2.mp3" }) == std::vector<std::string>({ "a/b" })));
+
+   // A file on its own stays as it is
+   CPPUNIT_ASSERT((Roots({ "a/b/1.mp3", "a/c/2.mp3" }) == std::vector<std::string>({ "a/b/1.mp3", "a/c/2.mp3" })));
+
+   // Siblings at the top level are not widened to the root
+   CPPUNIT_ASSERT((Roots({ "1.mp3", "2.mp3" }) == std::vector<std::string>({ "1.mp3", "2.mp3" })));
+}
+
+void UpdateRootsTester::nesting()
+{
+   CPPUNIT_ASSERT((Roots({ "a/b/c/1.mp3", "a" }) == std::vector<std::string>({ "a" })));
+   CPPUNIT_ASSERT((Roots({ "a", "a", "ab" }) == std::vector<std::string>({ "a", "ab" })));
+}
+
+void UpdateRootsTester::root()
+{
+   CPPUNIT_ASSERT((Roots({ "a/1.mp3", "" }) == std::vector<std::string>({ "" })));
+   CPPUNIT_ASSERT((Roots({ }).empty() == true));
+}
+
+void UpdateRootsTester::overflow()
+{
+   std::vector<std::string> shared;
+   std::vector<std::string> unrelated;
+
+   for (int i = 0; i < 20; ++i)
+   {
+      char path[32];
+      snprintf(path, sizeof(path), "music/%02d/1.mp3", i);
+      shared.push_back(path);
+
+      snprintf(path, sizeof(path), "%02d/1.mp3", i);
+      unrelated.push_back(path);
+   }
+
+   // Too many paths become their common ancestor
+   CPPUNIT_ASSERT((Roots(shared) == std::vector<std::string>({ "music" })));
+
+   // Unless that is the root, then they are all kept
+   CPPUNIT_ASSERT((Roots(unrelated) == unrelated));
+   CPPUNIT_ASSERT((Roots(shared, 20) == shared));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(UpdateRootsTester);
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(UpdateRootsTester, "updateroots");
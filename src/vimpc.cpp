@@ -33,6 +33,7 @@
 #include "events.hpp"
 #include "settings.hpp"
 #include "song.hpp"
+#include "stats.hpp"
 #include "test.hpp"
 
 #include "buffer/directory.hpp"
@@ -41,6 +42,7 @@
 #include "window/error.hpp"
 #include "window/songwindow.hpp"
 
+#include <deque>
 #include <list>
 #include <unistd.h>
 
@@ -49,16 +51,63 @@ using namespace Main;
 typedef std::pair<int32_t, EventData>  EventPair;
 
 static std::list<EventPair>            Queue;
-static std::map<int, std::vector<FUNCTION<void(EventData const &)> > > Handler;
+static std::list<EventData>            InputQueue;
+static std::map<int32_t, std::list<EventPair>::iterator> Pending;
+// A handler may register others whilst it runs, a deque keeps it in place
+static std::deque<FUNCTION<void(EventData const &)> > Handler[Event::EventCount];
 
 static Mutex               EventMutex;
 static Mutex               QueueMutex;
 static ConditionVariable   Condition;
+static bool                Woken = false;
 
 static std::map<int, std::list<ConditionVariable *> > WaitConditions;
 
 bool Vimpc::Running = true;
 
+// Queued events are handled for up to this long each frame, so that input and
+// painting carry on whilst a large database is loading
+static long const FrameBudgetMs = 8;
+
+// Events that only matter for their latest value, one that is still
+// queued is given the new data rather than another being added
+static bool Coalesces(int32_t type)
+{
+   return ((type == Event::Repaint)         ||
+           (type == Event::Elapsed)         ||
+           (type == Event::Volume)          ||
+           (type == Event::StatusUpdate)    ||
+           (type == Event::CurrentState)    ||
+           (type == Event::TotalSongCount)  ||
+           (type == Event::LyricsPercent)   ||
+           (type == Event::DisplaySongInfo));
+}
+
+// Run the handlers of an event and wake anything that is waiting for it
+static void DispatchEvent(int32_t type, EventData const & data)
+{
+   std::deque<FUNCTION<void(EventData const &)> > const & Handlers = Handler[type];
+   Chrono::steady_clock::time_point const Start = Chrono::steady_clock::now();
+
+   for (size_t i = 0; i < Handlers.size(); ++i)
+   {
+      Handlers[i](data);
+   }
+
+   Main::Stats::Instance().AddEvent(EventStrings::Default[type], Main::Stats::Elapsed(Start));
+
+   EventMutex.lock();
+
+   for (auto cond : WaitConditions[type])
+   {
+      cond->notify_all();
+   }
+
+   EventMutex.unlock();
+
+   Debug("Event triggered: " + EventStrings::Default[type]);
+}
+
 // \todo the coupling and requirements on the way everything needs to be constructed is awful
 // this really needs to be fixed and the coupling removed
 Vimpc::Vimpc() :
@@ -172,38 +221,52 @@ void Vimpc::Run(std::string hostname, uint16_t port)
          {
             UniqueLock<Mutex> Lock(QueueMutex);
 
-            if ((Queue.empty() == false) ||
-               (ConditionWait(Condition, Lock, 100) != false))
+            // Sleep until there is input, an event or something else that needs painting
+            while ((InputQueue.empty() == true) && (Queue.empty() == true) &&
+                   (Woken == false) && (Running == true))
             {
-               if (Queue.empty() == false)
-               {
-                  EventPair const Event = Queue.front();
-                  Queue.pop_front();
-                  Lock.unlock();
+               Condition.wait(Lock);
+            }
 
-                  if ((userEvents_ == false) &&
-                     (Event.second.user == true))
-                  {
-                     Debug("Discarding user event");
-                     continue;
-                  }
+            Woken = false;
 
-                  for (auto func : Handler[Event.first])
-                  {
-                     func(Event.second);
-                  }
+            // Keys are queued separately so that they are never stuck behind a
+            // backlog of other events, one is handled each frame
+            if (InputQueue.empty() == false)
+            {
+               EventData const Data(std::move(InputQueue.front()));
+               InputQueue.pop_front();
+               Lock.unlock();
+
+               if ((userEvents_ == true) || (Data.user == false))
+               {
+                  DispatchEvent(Event::Input, Data);
+               }
+               else
+               {
+                  Debug("Discarding user event");
+               }
 
-                  EventMutex.lock();
+               Lock.lock();
+            }
 
-                  for (auto cond : WaitConditions[Event.first])
-                  {
-                     cond->notify_all();
-                  }
+            // Other events get what is left of the frame, or until another key arrives
+            Chrono::steady_clock::time_point const Start = Chrono::steady_clock::now();
 
-                  EventMutex.unlock();
+            while ((Queue.empty() == false) && (InputQueue.empty() == true) &&
+                   (Chrono::duration_cast<Chrono::milliseconds>(Chrono::steady_clock::now() - Start).count() < FrameBudgetMs))
+            {
+               EventPair const Event(std::move(Queue.front()));
+               Queue.pop_front();
 
-                  Debug("Event triggered: " + EventStrings::Default[Event.first]);
+               if (Coalesces(Event.first) == true)
+               {
+                  Pending.erase(Event.first);
                }
+
+               Lock.unlock();
+               DispatchEvent(Event.first, Event.second);
+               Lock.lock();
             }
          }
 
@@ -262,7 +325,9 @@ void Vimpc::Repaint()
 
    if (Running)
    {
+      Chrono::steady_clock::time_point const Start = Chrono::steady_clock::now();
       screen_.Update();
+      Main::Stats::Instance().AddTiming("repaint", Main::Stats::Elapsed(Start));
       clientState_.DisplaySongInformation();
 
       if (screen_.PagerIsVisible() == false)
@@ -350,18 +415,54 @@ void Vimpc::HandleUserEvents(bool Enabled)
 /* static */ void Vimpc::SetRunning(bool isRunning)
 {
    Running = isRunning;
+   Wake();
+}
+
+/* static */ void Vimpc::Wake()
+{
+   UniqueLock<Mutex> Lock(QueueMutex);
+   Woken = true;
+   Condition.notify_all();
 }
 
 /* static */ void Vimpc::CreateEvent(int Event, EventData const & Data)
+{
+   CreateEvent(Event, EventData(Data));
+}
+
+/* static */ void Vimpc::CreateEvent(int Event, EventData && Data)
 {
    UniqueLock<Mutex> Lock(QueueMutex);
-   Queue.push_back(std::make_pair(Event, Data));
+
+   std::map<int32_t, std::list<EventPair>::iterator>::iterator const it = Pending.find(Event);
+
+   if (Event == Event::Input)
+   {
+      InputQueue.push_back(std::move(Data));
+      Main::Stats::Instance().QueueDepth("input", InputQueue.size());
+   }
+   else if (it != Pending.end())
+   {
+      it->second->second = std::move(Data);
+   }
+   else
+   {
+      Queue.push_back(std::make_pair(Event, std::move(Data)));
+
+      if (Coalesces(Event) == true)
+      {
+         Pending[Event] = --Queue.end();
+      }
+
+      Main::Stats::Instance().QueueDepth("events", Queue.size());
+   }
+
    Condition.notify_all();
 }
 
 /* static */ void Vimpc::EventHandler(int Event, FUNCTION<void(EventData const &)> func)
 {
-   Handler[Event].push_back(func);
+   Handler[Event].push_back(std::move(func));
 }
 
 /* static */ bool Vimpc::WaitForEvent(int Event, int TimeoutMs)
@@ -76,7 +76,13 @@ namespace Main
 
    public:
       static void SetRunning(bool isRunning);
+
+      //! Wake the main loop without an event, such as to show an error
+      static void Wake();
       static void CreateEvent(int Event, EventData const & Data);
+
+      //! Data that is not needed afterwards is moved into the queue rather than copied
+      static void CreateEvent(int Event, EventData && Data);
       static void EventHandler(int Event, FUNCTION<void(EventData const &)> func);
       static bool WaitForEvent(int Event, int TimeoutMs);
 
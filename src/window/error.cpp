@@ -19,6 +19,7 @@
    */
 
 #include "error.hpp"
+#include "vimpc.hpp"
 
 
 void Error(uint32_t errorNumber, std::string errorString)
@@ -40,6 +41,9 @@ void Error(uint32_t errorNumber, std::string errorString)
       }
 
       errorWindow.ErrorMutex.unlock();
+
+      // Errors raised by other threads are shown as soon as they happen
+      Main::Vimpc::Wake();
    }
 }
 
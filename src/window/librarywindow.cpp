@@ -128,6 +128,29 @@ uint32_t LibraryWindow::Current() const
    return current;
 }
 
+uint32_t LibraryWindow::FetchTags(uint32_t line, uint32_t count, bool notify) const
+{
+   if (settings_.Get(Setting::LazyTags) == true)
+   {
+      // Placeholders are filed under the unknown artist, only the expanded songs are fetched
+      std::vector<Mpc::Song *> Songs;
+
+      for (uint32_t i = line; ((i < line + count) && (i < library_.Size())); ++i)
+      {
+         Mpc::LibraryEntry const * const entry = library_.Get(i);
+
+         if ((entry->type_ == Mpc::SongType) && (entry->song_ != NULL))
+         {
+            Songs.push_back(entry->song_);
+         }
+      }
+
+      return client_.FetchTags(Songs, notify);
+   }
+
+   return 0;
+}
+
 std::string LibraryWindow::SearchPattern(uint32_t id) const
 {
    //! \todo add a search that searches in collapsed songs and
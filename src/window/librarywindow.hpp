@@ -61,6 +61,7 @@ namespace Ui
 
    public:
       std::string SearchPattern(uint32_t id) const;
+      uint32_t FetchTags(uint32_t line, uint32_t count, bool notify) const;
 
    public:
       void AddLine(uint32_t line, uint32_t count = 1, bool scroll = true);
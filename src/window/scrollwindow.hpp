@@ -67,6 +67,13 @@ namespace Ui
       virtual uint32_t Playlist(int count) const { return Current(); };
       virtual std::string SearchPattern(uint32_t id) const { return ""; }
 
+      //! Fetch the tags of lazily listed songs on these lines, if asked to notify and any
+      //! are still to arrive this returns the id that the TagsApplied event will carry
+      virtual uint32_t FetchTags(uint32_t line, uint32_t count, bool notify) const { return 0; }
+
+      //! Request more of a buffer that is still being listed once these lines are shown
+      virtual void FetchMore(uint32_t line, uint32_t count) const { }
+
       bool IsEnabled() { return enabled_; }
       void Disable()   { enabled_ = false; }
       void Enable()    { enabled_ = true; }
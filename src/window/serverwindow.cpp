@@ -0,0 +1,93 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   serverwindow.cpp - lists the mpd instances being monitored
+   */
+
+#include "serverwindow.hpp"
+
+#include "mpdclient.hpp"
+#include "regex.hpp"
+#include "settings.hpp"
+#include "screen.hpp"
+#include "mode/search.hpp"
+
+using namespace Ui;
+
+ServerWindow::ServerWindow(Main::Settings const & settings, Ui::Screen & screen, Mpc::Servers & servers, Mpc::Client & client, Ui::Search const & search) :
+   SelectWindow     (settings, screen, "servers"),
+   settings_        (settings),
+   client_          (client),
+   search_          (search),
+   servers_         (servers)
+{
+   servers_.AddCallback(Main::Buffer_Remove, [this] (Mpc::Servers::BufferType line) { AdjustScroll(line); });
+}
+
+ServerWindow::~ServerWindow()
+{
+}
+
+
+void ServerWindow::Confirm()
+{
+   if (CurrentLine() < BufferSize())
+   {
+      Mpc::Server const * const server = servers_.Get(CurrentLine());
+
+      // The client is reconnected and reloads everything from the new server,
+      // the library cache only saves listing its database again
+      client_.Connect(server->Hostname(), server->Port());
+   }
+
+   SelectWindow::Confirm();
+}
+
+
+int32_t ServerWindow::DetermineColour(uint32_t line) const
+{
+   int32_t  colour    = settings_.colours.Song;
+   uint32_t printLine = line + FirstLine();
+
+   if (printLine < servers_.Size())
+   {
+      if ((search_.LastSearchString() != "") && (settings_.Get(Setting::HighlightSearch) == true) &&
+          (search_.HighlightSearch() == true))
+      {
+         Regex::RE expression (".*" + search_.LastSearchString() + ".*", search_.LastSearchOptions());
+
+         if (expression.CompleteMatch(servers_.Get(printLine)->Hostname()) == true)
+         {
+            colour = settings_.colours.SongMatch;
+         }
+      }
+
+      if (servers_.Active(printLine) == true)
+      {
+         colour = settings_.colours.CurrentSong;
+      }
+   }
+
+   return colour;
+}
+
+
+void ServerWindow::AdjustScroll(Mpc::Server * server)
+{
+   LimitCurrentSelection();
+}
+/* vim: set sw=3 ts=3: */
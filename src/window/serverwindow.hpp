@@ -0,0 +1,80 @@
+/*
+   Vimpc
+   Copyright (C) 2013 Nathan Sweetman
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   serverwindow.hpp - lists the mpd instances being monitored
+   */
+
+#ifndef __UI__SERVERWINDOW
+#define __UI__SERVERWINDOW
+
+// Includes
+#include <iostream>
+
+#include "buffer/servers.hpp"
+#include "window/selectwindow.hpp"
+
+// Forward Declarations
+namespace Main { class Settings; }
+namespace Mpc  { class Client; }
+namespace Ui   { class Search; }
+
+// Server window class
+namespace Ui
+{
+   class ServerWindow : public Ui::SelectWindow
+   {
+   public:
+      ServerWindow(Main::Settings const & settings, Ui::Screen & screen, Mpc::Servers & servers, Mpc::Client & client, Ui::Search const & search);
+      ~ServerWindow();
+
+   private:
+      ServerWindow(ServerWindow & window);
+      ServerWindow & operator=(ServerWindow & window);
+
+   public:
+      void Left(Ui::Player & player, uint32_t count)  { }
+      void Right(Ui::Player & player, uint32_t count) { }
+      void Confirm();
+
+   public:
+      std::string SearchPattern(uint32_t id) const
+      {
+         if (id < servers_.Size())
+         {
+            return servers_.Get(id)->Hostname();
+         }
+         return "";
+      }
+
+   protected:
+      Main::WindowBuffer const & WindowBuffer() const { return servers_; }
+
+   private:
+      uint32_t BufferSize() const { return servers_.Size(); }
+      int32_t  DetermineColour(uint32_t line) const;
+      void     AdjustScroll(Mpc::Server * server);
+
+   private:
+      Main::Settings const & settings_;
+      Mpc::Client          & client_;
+      Ui::Search     const & search_;
+      Mpc::Servers         & servers_;
+   };
+}
+
+#endif
+/* vim: set sw=3 ts=3: */
@@ -43,7 +43,10 @@ SongWindow::SongWindow(Main::Settings const & settings, Ui::Screen & screen, Mpc
    client_          (client),
    clientState_     (clientState),
    search_          (search),
-   browse_          ()
+   browse_          (),
+   searchId_        (0),
+   searchOffset_    (0),
+   searchMore_      (false)
 {
 }
 
@@ -84,6 +87,38 @@ std::string SongWindow::SearchPattern(uint32_t id) const
    return "";
 }
 
+uint32_t SongWindow::FetchTags(uint32_t line, uint32_t count, bool notify) const
+{
+   if (settings_.Get(Setting::LazyTags) == true)
+   {
+      std::vector<Mpc::Song *> Songs;
+
+      for (uint32_t i = line; ((i < line + count) && (i < Buffer().Size())); ++i)
+      {
+         Songs.push_back(Buffer().Get(i));
+      }
+
+      return client_.FetchTags(Songs, notify);
+   }
+
+   return 0;
+}
+
+void SongWindow::FetchMore(uint32_t line, uint32_t count) const
+{
+   if ((searchMore_ == true) && (line + count >= BufferSize()))
+   {
+      client_.SearchMore(searchId_, searchOffset_);
+   }
+}
+
+void SongWindow::SetSearch(uint32_t id, uint32_t offset, bool more)
+{
+   searchId_     = id;
+   searchOffset_ = offset;
+   searchMore_   = more;
+}
+
 
 void SongWindow::Print(uint32_t line) const
 {
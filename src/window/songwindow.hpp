@@ -61,6 +61,13 @@ namespace Ui
 
    public:
       std::string SearchPattern(uint32_t id) const;
+      uint32_t FetchTags(uint32_t line, uint32_t count, bool notify) const;
+      void FetchMore(uint32_t line, uint32_t count) const;
+
+   public:
+      //! Search results that mpd sends a page at a time, offset is how far into them the window is
+      void SetSearch(uint32_t id, uint32_t offset, bool more);
+      uint32_t SearchId() const { return searchId_; }
 
    public:
       void AddLine(uint32_t line, uint32_t count = 1, bool scroll = true);
@@ -99,6 +106,9 @@ namespace Ui
       Mpc::ClientState     & clientState_;
       Ui::Search     const & search_;
       Mpc::Browse            browse_;
+      uint32_t               searchId_;
+      uint32_t               searchOffset_;
+      bool                   searchMore_;
    };
 }
 